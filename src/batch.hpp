@@ -0,0 +1,170 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "runner.hpp"
+#include "threadpool.hpp"
+
+using namespace std;
+
+// Programs named by a manifest (one path per line, '#' starts a comment,
+// relative paths are taken from the manifest's folder) or every *.txt
+// listing and *.elf executable in a directory, in sorted order
+inline vector<string> listPrograms(const string& source) {
+    namespace fs = std::filesystem;
+    vector<string> paths;
+    if (fs::is_directory(source)) {
+        for (auto& entry : fs::directory_iterator(source)) {
+            if (entry.is_regular_file() && (entry.path().extension() == ".txt" || entry.path().extension() == ".elf")) {
+                paths.push_back(entry.path().string());
+            }
+        }
+        sort(paths.begin(), paths.end());
+        return paths;
+    }
+    ifstream manifest(source);
+    if (!manifest.is_open()) {
+        throw runtime_error("Error opening manifest: " + source);
+    }
+    fs::path base = fs::path(source).parent_path();
+    string line;
+    while (getline(manifest, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos) continue;
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+        fs::path path(line);
+        paths.push_back((path.is_relative() && !base.empty() ? base / path : path).string());
+    }
+    return paths;
+}
+
+// Load and predecode each program once on the pool. Failures leave an empty
+// program and the reason in errors[i].
+inline vector<Program> loadPrograms(ThreadPool& pool, const vector<string>& paths, vector<string>& errors) {
+    vector<Program> programs(paths.size());
+    errors.assign(paths.size(), "");
+    for (size_t i = 0; i < paths.size(); i++) {
+        pool.submit([&, i] {
+            try {
+                programs[i] = loadProgram(paths[i]);
+            } catch (const exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    }
+    pool.wait();
+    return programs;
+}
+
+struct BatchOptions {
+    uint64_t cycles = 0;
+    vector<ModeEntry> modes;
+    PipelineConfig config;
+    string format = "text";
+    string outDir = "../outputfiles";
+    size_t jobs = 0; // Worker threads, 0 = one per core
+};
+
+// One program x mode simulation of a batch
+struct BatchJob {
+    size_t program = 0;
+    size_t mode = 0;
+    SimResult result;
+    string error;
+};
+
+// Simulate every program under every mode on a work-stealing pool. Each job
+// writes <outDir>/<program>.<mode>_out.txt (or .bin); the per-job results are
+// collected into <outDir>/summary.csv and a per-mode total on stdout.
+// Returns the number of failed jobs.
+inline size_t runBatch(const vector<string>& paths, const BatchOptions& options) {
+    namespace fs = std::filesystem;
+    ThreadPool pool(options.jobs);
+    auto start = chrono::steady_clock::now();
+
+    // Every mode shares each loaded program read-only
+    vector<string> loadErrors;
+    vector<Program> programs = loadPrograms(pool, paths, loadErrors);
+
+    // Output names come from the file stem, disambiguated if two collide
+    vector<string> names(paths.size());
+    map<string, int> seen;
+    for (size_t i = 0; i < paths.size(); i++) {
+        string stem = fs::path(paths[i]).stem().string();
+        int n = seen[stem]++;
+        names[i] = n ? stem + "_" + to_string(n) : stem;
+    }
+
+    string extension = (options.format == "binary") ? ".bin" : ".txt";
+    vector<BatchJob> jobs;
+    for (size_t p = 0; p < paths.size(); p++) {
+        for (size_t m = 0; m < options.modes.size(); m++) {
+            BatchJob job;
+            job.program = p;
+            job.mode = m;
+            job.error = loadErrors[p];
+            jobs.push_back(job);
+        }
+    }
+    for (BatchJob& job : jobs) {
+        if (!job.error.empty()) continue;
+        pool.submit([&] {
+            const ModeEntry& mode = options.modes[job.mode];
+            string path = options.outDir + "/" + names[job.program] + "." + mode.name + "_out" + extension;
+            RunOptions run;
+            run.start = initialState(programs[job.program]);
+            run.config = options.config;
+            run.cycles = options.cycles;
+            run.format = options.format;
+            run.path = path;
+            try {
+                job.result = mode.run(programs[job.program], run);
+            } catch (const exception& e) {
+                job.error = e.what();
+            }
+        });
+    }
+    pool.wait();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    string summaryPath = options.outDir + "/summary.csv";
+    ofstream summary(summaryPath);
+    if (!summary.is_open()) {
+        throw runtime_error("Error opening " + summaryPath);
+    }
+    summary << "program;mode;cycles;instructions;cpi;stall_cycles;branch_bubbles;mem_stall_cycles;fetch_stall_cycles;"
+            << "l1i_misses;l1d_misses;branches;mispredicts;error\n";
+    vector<SimResult> totals(options.modes.size());
+    size_t failed = 0;
+    for (const BatchJob& job : jobs) {
+        const SimResult& r = job.result;
+        summary << paths[job.program] << ";" << options.modes[job.mode].name << ";";
+        if (job.error.empty()) {
+            summary << r.cycles << ";" << r.retired << ";" << fixed << setprecision(3) << cpi(r) << defaultfloat << ";"
+                    << r.stall_cycles << ";" << r.branch_bubbles << ";" << r.mem_stall_cycles << ";" << r.fetch_stall_cycles << ";"
+                    << r.l1i.misses << ";" << r.l1d.misses << ";" << r.branches.branches << ";" << r.branches.mispredicts << ";\n";
+            addResult(totals[job.mode], r);
+        } else {
+            summary << ";;;;;;;;;;;" << job.error << "\n";
+            cerr << paths[job.program] << " (" << options.modes[job.mode].name << "): " << job.error << endl;
+            failed++;
+        }
+    }
+
+    cout << "Batch: " << paths.size() << " programs x " << options.modes.size() << " modes = " << jobs.size()
+         << " jobs on " << pool.size() << " threads in " << fixed << setprecision(2) << seconds << "s" << defaultfloat;
+    if (seconds > 0) cout << " (" << fixed << setprecision(1) << jobs.size() / seconds << " jobs/s)" << defaultfloat;
+    cout << "\n";
+    for (size_t m = 0; m < options.modes.size(); m++) {
+        const SimResult& t = totals[m];
+        cout << options.modes[m].name << ": " << t.cycles << " cycles, " << t.retired << " instructions, CPI "
+             << fixed << setprecision(3) << cpi(t) << defaultfloat << ", " << t.stall_cycles << " stall cycles, "
+             << t.branch_bubbles << " branch bubbles, " << t.mem_stall_cycles << " memory stall cycles";
+        if (t.l1i.hits + t.l1i.misses) cout << ", " << t.fetch_stall_cycles << " fetch stall cycles, " << t.l1i.misses << " L1I misses";
+        if (t.l1d.hits + t.l1d.misses) cout << ", " << t.l1d.misses << " L1D misses";
+        if (t.branches.branches) cout << ", " << t.branches.mispredicts << " of " << t.branches.branches << " branches mispredicted";
+        cout << "\n";
+    }
+    if (failed) cout << failed << " jobs failed\n";
+    cout << "Summary written to " << summaryPath << "\n";
+    return failed;
+}
@@ -0,0 +1,299 @@
+#include <bits/stdc++.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "batch.hpp"
+#include "forwarding.hpp"
+#include "noforwarding.hpp"
+
+using namespace std;
+
+// Simulator benchmark: times ForwardingProcessor and NoForwardingProcessor
+// over the inputfiles kernels and over large generated programs, reporting
+// simulated cycles per host second, load time and peak RSS, and compares
+// the throughput of the generated programs against a checked-in baseline.
+// The kernels halt within a few dozen cycles, so their rate mostly times
+// building the processor; they are reported but not gated. Every benchmark
+// runs in a child process, so its peak RSS is its own.
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--baseline <file.csv>] [--update] [--threshold 0.15] [--inputs <dir>]"
+         << " [--cycles N] [--min-time S] [--only <name>]\n"
+         << "Without --update, a benchmark whose throughput falls (or whose load time grows) by more than"
+         << " the threshold against the baseline is flagged and the exit status is 1." << endl;
+}
+
+// A long straight-line body of mixed ALU, load and store instructions with
+// never-taken branches, run four times: most of the time goes to loading
+// and predecoding, and the simulation never sees the same pc twice in a row
+static vector<uint32_t> straightProgram(size_t body) {
+    mt19937 rng(25);
+    auto reg = [&] { return uint32_t(1 + rng() % 15); };
+    vector<uint32_t> words = {encodeI(4, 0, 0x0, 31, 0x13), encodeU(0x10, 30, 0x37)}; // x31 passes, x30 data
+    static const uint32_t funct3s[] = {0x0, 0x2, 0x4, 0x6, 0x7};
+    for (size_t i = 0; i < body; i++) {
+        uint32_t pick = rng() % 10;
+        if (pick < 4) words.push_back(encodeR(rng() % 4 ? 0 : 0x20, reg(), reg(), funct3s[rng() % 5], reg()));
+        else if (pick < 6) words.push_back(encodeI(int32_t(rng() % 512) - 256, reg(), 0x0, reg(), 0x13));
+        else if (pick < 8) words.push_back(encodeI(int32_t(rng() % 512) * 4, 30, 0x2, reg(), 0x03));
+        else if (pick < 9) words.push_back(encodeS(int32_t(rng() % 512) * 4, reg(), 30, 0x2));
+        else words.push_back(encodeB(8, 0, 0, 0x1)); // bne x0 x0: never taken
+    }
+    words.push_back(encodeI(-1, 31, 0x0, 31, 0x13));
+    words.push_back(encodeB(8, 0, 31, 0x0)); // Leave once x31 reaches zero
+    words.push_back(encodeJ(-int32_t(body + 2) * 4, 0)); // Back to the top of the body
+    return words;
+}
+
+// A small loop over a 4 KiB array with a load-use pair, a store and a
+// data-dependent branch, iterated 2^18 times: the hot loop of the pipeline
+static vector<uint32_t> loopProgram() {
+    return {
+        encodeU(0x10, 30, 0x37),          // lui x30 0x10: array base
+        encodeU(0x40, 29, 0x37),          // lui x29 0x40: iterations
+        encodeI(1023, 31, 0x7, 5, 0x13),  // loop: andi x5 x31 1023
+        encodeI(2, 5, 0x1, 5, 0x13),      // slli x5 x5 2
+        encodeR(0, 5, 30, 0x0, 6),        // add x6 x30 x5
+        encodeI(0, 6, 0x2, 7, 0x03),      // lw x7 0 x6
+        encodeR(0, 7, 8, 0x0, 8),         // add x8 x8 x7
+        encodeI(3, 7, 0x0, 7, 0x13),      // addi x7 x7 3
+        encodeS(0, 7, 6, 0x2),            // sw x7 0 x6
+        encodeI(4, 7, 0x7, 9, 0x13),      // andi x9 x7 4
+        encodeB(8, 0, 9, 0x0),            // beq x9 x0 8
+        encodeR(0, 7, 8, 0x4, 8),         // xor x8 x8 x7
+        encodeI(1, 31, 0x0, 31, 0x13),    // addi x31 x31 1
+        encodeB(-44, 29, 31, 0x1),        // bne x31 x29 loop
+    };
+}
+
+struct Benchmark {
+    string name;
+    string path;
+    bool gated; // Kept in the baseline and checked against it
+};
+
+// What a child reports back through its pipe
+struct BenchSample {
+    double loadSeconds = 0;     // Best of benchRounds loads
+    double cyclesPerSecond = 0; // Best of benchRounds rounds of back-to-back runs
+    uint64_t cycles = 0;        // Of one run
+    char error[256] = {};
+};
+
+// Rounds each measurement is repeated; the best is kept, since other load
+// on the host only ever makes a round slower
+static const int benchRounds = 5;
+
+template <typename Core>
+static BenchSample measure(const string& path, int cycles, double minTime) {
+    using clock = chrono::steady_clock;
+    auto since = [](clock::time_point begin) { return chrono::duration<double>(clock::now() - begin).count(); };
+    BenchSample sample;
+    sample.loadSeconds = DBL_MAX;
+    for (int round = 0; round < benchRounds; round++) {
+        auto begin = clock::now();
+        Program loaded = loadProgram(path);
+        sample.loadSeconds = min(sample.loadSeconds, since(begin));
+    }
+
+    Program program = loadProgram(path);
+    PipelineConfig config;
+    NullDiagramWriter writer;
+    for (int round = 0; round < benchRounds; round++) {
+        // Short kernels run many times over, so every round takes a while
+        uint64_t simulated = 0;
+        double elapsed;
+        auto begin = clock::now();
+        do {
+            Core core(program, config);
+            SimResult result = core.simulate(cycles, writer, TraceLevel::Off);
+            simulated += result.cycles;
+            sample.cycles = result.cycles;
+            elapsed = since(begin);
+        } while (elapsed < minTime / benchRounds);
+        sample.cyclesPerSecond = max(sample.cyclesPerSecond, simulated / elapsed);
+    }
+    return sample;
+}
+
+// Run measure() in a child process; peakKb is the child's peak RSS
+static BenchSample isolated(const function<BenchSample()>& measure, long& peakKb) {
+    BenchSample sample;
+    int fds[2];
+    if (pipe(fds) != 0) throw runtime_error("pipe failed");
+    pid_t pid = fork();
+    if (pid < 0) throw runtime_error("fork failed");
+    if (pid == 0) {
+        close(fds[0]);
+        try {
+            sample = measure();
+        } catch (const exception& e) {
+            snprintf(sample.error, sizeof sample.error, "%s", e.what());
+        }
+        ssize_t written = write(fds[1], &sample, sizeof sample);
+        _exit(written == ssize_t(sizeof sample) ? 0 : 1);
+    }
+    close(fds[1]);
+    size_t got = 0;
+    for (ssize_t n; got < sizeof sample && (n = read(fds[0], reinterpret_cast<char*>(&sample) + got, sizeof sample - got)) > 0;) got += size_t(n);
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage {};
+    wait4(pid, &status, 0, &usage);
+    peakKb = usage.ru_maxrss;
+    if (got != sizeof sample) snprintf(sample.error, sizeof sample.error, "benchmark process failed");
+    return sample;
+}
+
+struct BenchRow {
+    string benchmark, mode;
+    uint64_t cycles = 0;
+    double mcyclesPerSecond = 0;
+    double loadMs = 0;
+    long peakRssKb = 0;
+};
+
+static const char* const baselineHeader = "benchmark,mode,cycles,mcycles_per_second,load_ms,peak_rss_kb";
+
+static map<pair<string, string>, BenchRow> readBaseline(const string& path) {
+    map<pair<string, string>, BenchRow> rows;
+    ifstream in(path);
+    string line;
+    if (!in.is_open() || !getline(in, line)) return rows;
+    while (getline(in, line)) {
+        stringstream ss(line);
+        BenchRow row;
+        string field;
+        vector<string> fields;
+        while (getline(ss, field, ',')) fields.push_back(field);
+        if (fields.size() != 6) continue;
+        row.benchmark = fields[0];
+        row.mode = fields[1];
+        row.cycles = stoull(fields[2]);
+        row.mcyclesPerSecond = stod(fields[3]);
+        row.loadMs = stod(fields[4]);
+        row.peakRssKb = stol(fields[5]);
+        rows[{row.benchmark, row.mode}] = row;
+    }
+    return rows;
+}
+
+static void writeBaseline(const string& path, const vector<BenchRow>& rows) {
+    ofstream out(path);
+    if (!out.is_open()) throw runtime_error("Error opening " + path);
+    out << baselineHeader << "\n" << fixed;
+    for (const BenchRow& row : rows) {
+        out << row.benchmark << "," << row.mode << "," << row.cycles << "," << setprecision(3) << row.mcyclesPerSecond << ","
+            << setprecision(4) << row.loadMs << "," << row.peakRssKb << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    string baselinePath, inputDir = "../inputfiles", only;
+    bool update = false;
+    double threshold = 0.15, minTime = 0.3;
+    int cycles = 100000000;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--update") {
+            update = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--baseline") baselinePath = value;
+        else if (arg == "--threshold") threshold = stod(value);
+        else if (arg == "--inputs") inputDir = value;
+        else if (arg == "--cycles") cycles = stoi(value);
+        else if (arg == "--min-time") minTime = stod(value);
+        else if (arg == "--only") only = value;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (update && baselinePath.empty()) {
+        cerr << "--update needs a --baseline to write" << endl;
+        return 1;
+    }
+
+    namespace fs = std::filesystem;
+    fs::path scratch = fs::temp_directory_path() / ("riscv_bench_" + to_string(getpid()));
+    int regressions = 0;
+    try {
+        vector<Benchmark> benchmarks;
+        for (const string& path : listPrograms(inputDir)) benchmarks.push_back({fs::path(path).stem().string(), path, false});
+        fs::create_directories(scratch);
+        benchmarks.push_back({"synthetic_straight", (scratch / "straight.txt").string(), true});
+        writeListing(benchmarks.back().path, straightProgram(200000));
+        benchmarks.push_back({"synthetic_loop", (scratch / "loop.txt").string(), true});
+        writeListing(benchmarks.back().path, loopProgram());
+
+        map<pair<string, string>, BenchRow> baseline;
+        if (!baselinePath.empty() && !update) baseline = readBaseline(baselinePath);
+
+        cout << left << setw(20) << "benchmark" << setw(11) << "mode" << right << setw(11) << "cycles" << setw(11)
+             << "load ms" << setw(12) << "Mcycles/s" << setw(11) << "peak RSS" << setw(14) << "vs baseline" << "\n";
+        vector<BenchRow> rows;
+        for (const Benchmark& bench : benchmarks) {
+            if (!only.empty() && bench.name.find(only) == string::npos) continue;
+            for (int policy = 0; policy < 2; policy++) {
+                BenchRow row;
+                row.benchmark = bench.name;
+                row.mode = policy ? NoForwardingPolicy::name : ForwardingPolicy::name;
+                BenchSample sample = isolated([&] {
+                    return policy ? measure<NoForwardingProcessor>(bench.path, cycles, minTime)
+                                  : measure<ForwardingProcessor>(bench.path, cycles, minTime);
+                }, row.peakRssKb);
+                cout << left << setw(20) << row.benchmark << setw(11) << row.mode << right;
+                if (sample.error[0]) {
+                    cout << "  " << sample.error << endl;
+                    regressions++;
+                    continue;
+                }
+                row.cycles = sample.cycles;
+                row.mcyclesPerSecond = sample.cyclesPerSecond / 1e6;
+                row.loadMs = sample.loadSeconds * 1000;
+                if (bench.gated) rows.push_back(row);
+                cout << setw(11) << row.cycles << fixed << setprecision(3) << setw(11) << row.loadMs << setprecision(2)
+                     << setw(12) << row.mcyclesPerSecond << setprecision(1) << setw(8) << row.peakRssKb / 1024.0 << " MB";
+
+                auto it = baseline.find({row.benchmark, row.mode});
+                if (!bench.gated) {
+                    if (!baseline.empty()) cout << setw(14) << "not gated";
+                } else if (it != baseline.end()) {
+                    const BenchRow& base = it->second;
+                    double change = row.mcyclesPerSecond / base.mcyclesPerSecond - 1;
+                    // Load times under a millisecond are mostly noise
+                    bool slower = change < -threshold;
+                    bool slowLoad = base.loadMs >= 1 && row.loadMs > base.loadMs * (1 + threshold);
+                    cout << showpos << setw(13) << change * 100 << "%" << noshowpos;
+                    if (slower || slowLoad) {
+                        cout << "  REGRESSION" << (slowLoad ? " (load)" : "");
+                        regressions++;
+                    }
+                    if (row.cycles != base.cycles) cout << "  cycles were " << base.cycles;
+                } else if (!baseline.empty()) {
+                    cout << setw(14) << "new";
+                }
+                cout << defaultfloat << endl;
+            }
+        }
+
+        if (update) {
+            writeBaseline(baselinePath, rows);
+            cout << "Baseline written to " << baselinePath << "\n";
+        } else if (!baseline.empty()) {
+            cout << regressions << " regression(s) beyond " << fixed << setprecision(0) << threshold * 100 << "% against " << baselinePath << "\n";
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        fs::remove_all(scratch);
+        return 1;
+    }
+    fs::remove_all(scratch);
+    return regressions ? 1 : 0;
+}
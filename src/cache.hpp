@@ -0,0 +1,176 @@
+#pragma once
+#include <bits/stdc++.h>
+
+using namespace std;
+
+enum class Replacement : uint8_t { LRU, FIFO, Random };
+
+// Geometry and policies of one cache level. A size of 0 disables the
+// cache: every access hits and nothing is counted.
+struct CacheConfig {
+    uint32_t size = 0;        // Bytes of data
+    uint32_t ways = 2;
+    uint32_t lineSize = 32;   // Bytes per line, at least 4
+    Replacement replacement = Replacement::LRU;
+    bool writeBack = true;    // Write-back with write-allocate, or write-through without
+    int missPenalty = 10;     // Extra cycles to fill a line
+
+    bool enabled() const { return size != 0; }
+    uint32_t sets() const { return size / (ways * lineSize); }
+};
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;  // Valid lines replaced
+    uint64_t writebacks = 0; // Dirty lines written back on eviction
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& s) {
+        ar.field(s.hits); ar.field(s.misses); ar.field(s.evictions); ar.field(s.writebacks);
+    }
+};
+
+// Set-associative cache that tracks tags only; the data stays in the
+// backing memory. Each set is a contiguous run of `ways` words holding the
+// line address plus valid and dirty bits, kept in recency (LRU) or
+// insertion (FIFO) order, so a lookup is one short linear scan.
+class Cache {
+    static const uint32_t VALID = 1, DIRTY = 2;
+
+    CacheConfig config;
+    uint32_t lineBits = 0;
+    uint32_t setMask = 0;
+    vector<uint32_t> tags; // sets * ways, way 0 most recent
+    uint32_t rng = 0x9E3779B9; // Victim choice for Replacement::Random
+    CacheStats counters;
+
+    // Fill line into set, evicting the oldest (or a random) way; returns
+    // the way it went to
+    uint32_t fill(uint32_t* set, uint32_t line) {
+        uint32_t victim = config.ways - 1;
+        if (config.replacement == Replacement::Random) {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            victim = rng % config.ways;
+        }
+        if (set[victim] & VALID) {
+            counters.evictions++;
+            if (set[victim] & DIRTY) counters.writebacks++;
+        }
+        if (config.replacement == Replacement::Random) {
+            set[victim] = line | VALID;
+            return victim;
+        }
+        memmove(set + 1, set, victim * sizeof(uint32_t));
+        set[0] = line | VALID;
+        return 0;
+    }
+
+public:
+    Cache() = default;
+    explicit Cache(const CacheConfig& config) : config(config) {
+        if (!config.enabled()) return;
+        while ((1u << lineBits) < config.lineSize) lineBits++;
+        setMask = config.sets() - 1;
+        tags.assign(size_t(config.sets()) * config.ways, 0);
+    }
+
+    bool enabled() const { return config.enabled(); }
+    const CacheStats& stats() const { return counters; }
+
+    // Look up the line holding addr and update it; returns the extra
+    // cycles the access costs (0 on a hit). Writes that miss a
+    // write-through cache go straight to memory without a fill.
+    int access(uint32_t addr, bool write) {
+        if (!config.enabled()) return 0;
+        uint32_t line = addr & ~((1u << lineBits) - 1);
+        uint32_t* set = &tags[size_t((addr >> lineBits) & setMask) * config.ways];
+        for (uint32_t way = 0; way < config.ways; way++) {
+            if ((set[way] & ~DIRTY) != (line | VALID)) continue;
+            counters.hits++;
+            uint32_t tag = set[way] | ((write && config.writeBack) ? DIRTY : 0);
+            if (config.replacement == Replacement::LRU) {
+                memmove(set + 1, set, way * sizeof(uint32_t));
+                way = 0;
+            }
+            set[way] = tag;
+            return 0;
+        }
+        counters.misses++;
+        if (write && !config.writeBack) return 0;
+        uint32_t way = fill(set, line);
+        if (write) set[way] |= DIRTY;
+        return config.missPenalty;
+    }
+
+    // Checkpoint contents: geometry, tags, counters and the random state.
+    // Restoring into a different geometry starts the cache cold.
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& c) {
+        uint64_t shape = uint64_t(c.config.sets()) << 32 | uint64_t(c.config.ways) << 8 | c.lineBits;
+        if (!c.config.enabled()) shape = 0;
+        uint64_t saved = shape;
+        ar.field(saved);
+        ar.array(c.tags);
+        ar.field(c.rng);
+        ar.field(c.counters);
+        if constexpr (!is_const<Self>::value) {
+            size_t lines = c.config.enabled() ? size_t(c.config.sets()) * c.config.ways : 0;
+            if (saved != shape) {
+                c.tags.assign(lines, 0);
+            } else if (c.tags.size() != lines) {
+                throw runtime_error("checkpoint holds " + to_string(c.tags.size()) + " cache tags where " +
+                                    to_string(lines) + " belong");
+            }
+        }
+    }
+};
+
+// Parse a cache description such as "size=8k,ways=4,line=64,repl=lru,write=back,penalty=20".
+// Every key is optional; size defaults to 4 KiB.
+inline bool parseCacheSpec(const string& text, CacheConfig& config) {
+    config = CacheConfig();
+    config.size = 4096;
+    stringstream ss(text);
+    string item;
+    auto number = [](string value, uint32_t& out) {
+        uint32_t scale = 1;
+        if (!value.empty() && (value.back() == 'k' || value.back() == 'K')) scale = 1024, value.pop_back();
+        else if (!value.empty() && (value.back() == 'm' || value.back() == 'M')) scale = 1 << 20, value.pop_back();
+        if (value.empty() || value.find_first_not_of("0123456789") != string::npos) return false;
+        out = uint32_t(stoul(value)) * scale;
+        return true;
+    };
+    while (getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) return false;
+        string key = item.substr(0, eq), value = item.substr(eq + 1);
+        uint32_t n = 0;
+        if (key == "size") {
+            if (!number(value, config.size)) return false;
+        } else if (key == "ways") {
+            if (!number(value, config.ways)) return false;
+        } else if (key == "line") {
+            if (!number(value, config.lineSize)) return false;
+        } else if (key == "penalty") {
+            if (!number(value, n)) return false;
+            config.missPenalty = int(n);
+        } else if (key == "repl") {
+            if (value == "lru") config.replacement = Replacement::LRU;
+            else if (value == "fifo") config.replacement = Replacement::FIFO;
+            else if (value == "random") config.replacement = Replacement::Random;
+            else return false;
+        } else if (key == "write") {
+            if (value == "back") config.writeBack = true;
+            else if (value == "through") config.writeBack = false;
+            else return false;
+        } else {
+            return false;
+        }
+    }
+    auto pow2 = [](uint32_t v) { return v && !(v & (v - 1)); };
+    return pow2(config.size) && pow2(config.ways) && pow2(config.lineSize) && config.lineSize >= 4 &&
+           uint64_t(config.ways) * config.lineSize <= config.size;
+}
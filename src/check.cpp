@@ -0,0 +1,858 @@
+#include <bits/stdc++.h>
+#include "trace.hpp"
+#include "tracefile.hpp"
+#include "runner.hpp"
+#include "batch.hpp"
+#include "functional.hpp"
+#include "counters.hpp"
+
+using namespace std;
+
+// Self-checks run by make check. Each group prints what it covered and
+// every failure; the exit status is 1 if anything failed.
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--programs 300] [--seed 1] [--keep <dir>]\n"
+         << "--programs and --seed choose the differential check's random programs; --keep leaves the\n"
+         << "generated programs and checkpoints in <dir>." << endl;
+}
+
+static int failures = 0;
+
+static void fail(const string& what) {
+    cout << "FAIL " << what << endl;
+    failures++;
+}
+
+// The record of one diagram row given as its cells, "IF;ID;-;EX;MEM;WB"
+// or "IF;IF2;ID;EX;MEM;MEM2;WB", with " " for the cycles before fetch; the
+// row starts at cycle 0
+static StageRecord rowRecord(const string& cells) {
+    StageRecord rec;
+    stringstream ss(cells);
+    string cell;
+    for (int64_t cycle = 0; getline(ss, cell, ';'); cycle++) {
+        for (int s = 0; s < NUM_STAGES; s++) {
+            if (cell == stageNames[s]) rec.enter[s] = cycle;
+            if (cell == splitStageNames[s]) rec.split[s] = uint16_t(cycle - rec.enter[s]);
+        }
+        if (cell != " ") rec.last = cycle;
+    }
+    return rec;
+}
+
+static string rowText(const StageRecord& rec, int64_t from = 0, int64_t to = INT64_MAX) {
+    stringstream ss;
+    writeDiagramRow(ss, "", rec, from, to);
+    string row = ss.str();
+    return row.substr(1, row.size() - 2); // Drop the text's ';' and the newline
+}
+
+// Rows back to their text, and tracetool's stall counts against the '-'
+// cells of the row, over the whole row and over every window of it
+static void checkDiagramRows() {
+    static const char* const rows[] = {
+        "IF;ID;EX;MEM;WB",
+        " ; ;IF;ID;-;-;EX;MEM;WB",
+        "IF;-;ID;EX;-;-;-;MEM;WB",
+        "IF;ID;-;EX;MEM;-;WB",
+        " ;IF;-;-",
+        "IF;ID",
+        "IF;IF2;ID;EX;MEM;MEM2;WB",
+        "IF;-;IF2;ID;RR;-;EX;EX2;MEM;-;MEM2;WB",
+        " ;IF;IF2;-;-;ID;-;RR;EX;MEM;MEM2;-;WB",
+        "IF;IF2;-",
+    };
+    int checked = 0;
+    for (const char* row : rows) {
+        StageRecord rec = rowRecord(row);
+        if (rowText(rec) != row) fail(string("row \"") + row + "\" reads back as \"" + rowText(rec) + "\"");
+        vector<string> cells;
+        stringstream ss(row);
+        for (string cell; getline(ss, cell, ';');) cells.push_back(cell);
+        for (int64_t from = 0; from < int64_t(cells.size()); from++) {
+            for (int64_t to = from; to < int64_t(cells.size()); to++) {
+                int64_t perStage[NUM_STAGES] = {};
+                int64_t want = count(cells.begin() + from, cells.begin() + to + 1, "-");
+                int64_t got = stallCycles(rec, from, to, perStage);
+                if (got != want || accumulate(perStage, perStage + NUM_STAGES, int64_t(0)) != got) {
+                    fail(string("stalls of \"") + row + "\" in [" + to_string(from) + ", " + to_string(to) + "]: " +
+                         to_string(got) + ", want " + to_string(want));
+                }
+                checked++;
+            }
+        }
+    }
+    cout << "diagram rows: " << size(rows) << " rows, " << checked << " stall windows" << endl;
+}
+
+// Random rows in program order, a few chunks' worth, including squashed
+// rows and rows that stay in their last stage
+static vector<StageRecord> randomRecords(mt19937& rng, size_t n, bool wide) {
+    vector<StageRecord> records;
+    int64_t fetch = 0;
+    uint32_t pc = 0;
+    for (size_t i = 0; i < n; i++) {
+        StageRecord rec;
+        rec.seq = i + 1;
+        pc = rng() % 8 ? pc + 4 : 4 * (rng() % 64);
+        rec.pc = pc;
+        fetch += rng() % 3;
+        rec.enter[STAGE_IF] = fetch;
+        rec.squashed = rng() % 10 == 0;
+        int stages = rec.squashed ? 1 + int(rng() % 2) : NUM_STAGES;
+        int64_t cycle = fetch;
+        for (int s = 1; s < stages; s++) {
+            cycle += 1 + (rng() % 4 == 0 ? rng() % 20 : 0);
+            rec.enter[s] = cycle;
+        }
+        // Wide and deep pipelines add slots and the second halves of split stages
+        for (int s = 0; wide && s < stages; s++) {
+            rec.slot[s] = uint8_t(rng() % 8);
+            int64_t leave = s + 1 < stages ? rec.enter[s + 1] : rec.last + 1;
+            if (leave - rec.enter[s] > 1 && rng() % 2) rec.split[s] = uint16_t(1 + rng() % (leave - rec.enter[s] - 1));
+        }
+        rec.last = cycle + (rng() % 5 == 0 ? rng() % 3 : 0);
+        records.push_back(rec);
+    }
+    return records;
+}
+
+static bool sameRecord(const StageRecord& a, const StageRecord& b) {
+    return a.seq == b.seq && a.pc == b.pc && equal(a.enter, a.enter + NUM_STAGES, b.enter) && a.last == b.last &&
+           equal(a.slot, a.slot + NUM_STAGES, b.slot) && equal(a.split, a.split + NUM_STAGES, b.split) &&
+           a.squashed == b.squashed;
+}
+
+// Records through BinaryTraceWriter and back, with and without issue
+// slots and split stages, whole and through cycle windows, which must
+// still return every row that touches the window
+static void checkBinaryTrace() {
+    mt19937 rng(1);
+    vector<string> instructions(64);
+    for (size_t i = 0; i < instructions.size(); i++) instructions[i] = "instr " + to_string(i);
+    size_t total = 0, windowCount = 0;
+    for (bool wide : {false, true}) {
+        vector<StageRecord> records = randomRecords(rng, 10000, wide);
+        FILE* file = tmpfile();
+        if (!file) {
+            fail("cannot create a temporary trace");
+            return;
+        }
+        BinaryTraceWriter writer(file, vector<string_view>(instructions.begin(), instructions.end()), 0, wide);
+        for (const StageRecord& rec : records) writer.write(rec);
+        writer.finish();
+
+        int64_t lastCycle = records.back().last;
+        vector<pair<int64_t, int64_t>> windows = {{0, INT64_MAX}, {0, 0}, {lastCycle / 2, lastCycle / 2 + 50}, {lastCycle - 10, INT64_MAX}};
+        for (int i = 0; i < 20; i++) {
+            int64_t from = rng() % (lastCycle + 1);
+            windows.push_back({from, from + int64_t(rng() % 2000)});
+        }
+        for (auto [from, to] : windows) {
+            rewind(file);
+            BinaryTraceReader reader(file);
+            if (reader.instructions != instructions) fail("trace instruction table differs");
+            reader.setWindow(from, to);
+            StageRecord rec;
+            size_t k = 0;
+            bool ok = true;
+            while (ok && reader.next(rec)) {
+                // Whole chunks come back; a window may only skip rows outside it
+                while (k < records.size() && records[k].seq < rec.seq) {
+                    if (records[k].last >= from && records[k].enter[STAGE_IF] <= to) ok = false;
+                    k++;
+                }
+                if (k == records.size() || !sameRecord(rec, records[k])) ok = false;
+                k++;
+            }
+            for (; ok && k < records.size(); k++) {
+                if (records[k].last >= from && records[k].enter[STAGE_IF] <= to) ok = false;
+            }
+            if (!ok) {
+                fail(string("trace") + (wide ? " with slots and split stages" : "") + " read back through [" + to_string(from) + ", " +
+                     to_string(to) + "] differs");
+            }
+        }
+        fclose(file);
+        total += records.size();
+        windowCount += windows.size();
+    }
+    cout << "binary trace: " << total << " records, " << windowCount << " windows, with and without slots and split stages" << endl;
+}
+
+// A loop of 40-120 random instructions run 1-40 times: ALU operations on
+// x0-x29, loads and stores around the data pointer x30, forward branches,
+// jal and jalr, calls and returns, lui, auipc and fence. x31 counts the
+// iterations, so every program ends.
+static vector<uint32_t> randomProgram(mt19937& rng) {
+    auto pick = [&](uint32_t n) { return uint32_t(rng() % n); };
+    auto between = [&](int lo, int hi) { return lo + int(rng() % uint32_t(hi - lo + 1)); };
+    vector<uint32_t> words = {encodeI(between(1, 40), 0, 0x0, 31, 0x13), encodeU(0x1, 30, 0x37)};
+    // A subroutine ahead of the loop, called from several places in it, so
+    // returns go back to different callers. It leaves x1 alone, and no
+    // jump lands in it but the calls.
+    int work = between(1, 4);
+    words.push_back(encodeJ(4 * (work + 2), 0));
+    size_t subroutine = words.size();
+    for (int i = 0; i < work; i++) words.push_back(encodeI(between(-8, 8), 6 + pick(24), 0x0, 6 + pick(24), 0x13));
+    words.push_back(encodeI(0, 1, 0x0, 0, 0x67));
+    size_t loop = words.size();
+    int body = between(40, 120);
+    // Half the accesses are to aligned words, so loads often meet older
+    // stores to the same address
+    auto offset = [&] { return pick(2) ? 4 * between(-8, 8) : between(-32, 32); };
+    static const uint32_t loadFunct3s[] = {0x0, 0x1, 0x2, 0x4, 0x5};
+    static const uint32_t links[] = {0, 1, 5};
+    for (int k = 0; k < body;) {
+        uint32_t rd = pick(30), rs1 = pick(30), rs2 = pick(30);
+        int left = body - k;
+        uint32_t kind = pick(100);
+        if (kind < 25) {
+            static const uint32_t funct7s[] = {0x00, 0x00, 0x20};
+            uint32_t funct3 = pick(8), funct7 = funct7s[pick(3)];
+            if (funct7 == 0x20 && funct3 != 0x0 && funct3 != 0x5) funct7 = 0;
+            words.push_back(encodeR(funct7, rs2, rs1, funct3, rd));
+        } else if (kind < 45) {
+            uint32_t funct3 = pick(8);
+            int imm = between(-2048, 2047);
+            if (funct3 == 0x1) imm = between(0, 31);
+            if (funct3 == 0x5) imm = between(0, 31) | (pick(2) ? 0x400 : 0);
+            words.push_back(encodeI(imm, rs1, funct3, rd, 0x13));
+        } else if (kind < 60) {
+            words.push_back(encodeI(offset(), 30, loadFunct3s[pick(5)], rd, 0x03));
+        } else if (kind < 72 && left > 3 && pick(3) == 0) {
+            // A store of loaded data and a load behind it from the same
+            // word, which must wait for the store or take its data
+            int from = 4 * between(-8, 8), to = 4 * between(-8, 8);
+            words.push_back(encodeI(from, 30, 0x2, rd, 0x03));
+            words.push_back(encodeS(to, rd, 30, 0x2));
+            words.push_back(encodeI(to, 30, loadFunct3s[pick(5)], rs1, 0x03));
+            k += 2;
+        } else if (kind < 72) {
+            words.push_back(encodeS(offset(), rs2, 30, pick(3)));
+        } else if (kind < 77) {
+            words.push_back(encodeU(uint32_t(rng()) >> 12, rd, pick(2) ? 0x37 : 0x17));
+        } else if (kind < 87 && left > 2) {
+            static const uint32_t branchFunct3s[] = {0x0, 0x1, 0x4, 0x5, 0x6, 0x7};
+            words.push_back(encodeB(4 * between(1, min(left - 1, 8)), rs2, rs1, branchFunct3s[pick(6)]));
+        } else if (kind < 90 && left > 2) {
+            words.push_back(encodeJ(4 * between(1, min(left - 1, 6)), pick(2) ? links[pick(3)] : rd));
+        } else if (kind < 93 && left > 2) {
+            // jalr from x0 straight to a later instruction of the body. A
+            // base register set just before could be skipped by a branch.
+            int target = int(words.size()) + between(1, min(left - 1, 6));
+            words.push_back(encodeI(4 * target, 0, 0x0, pick(2) ? 1 : rd, 0x67));
+        } else if (kind < 97) {
+            // A call to the shared subroutine, which returns here
+            words.push_back(encodeJ(int32_t(subroutine - words.size()) * 4, 1));
+        } else if (kind < 98) {
+            words.push_back(0x0000000F); // fence
+        } else {
+            words.push_back(encodeI(between(-2048, 2047), rs1, 0x0, rd, 0x13));
+        }
+        k++;
+    }
+    words.push_back(encodeI(-1, 31, 0x0, 31, 0x13));
+    words.push_back(encodeB(int32_t(loop - words.size()) * 4, 0, 31, 0x1)); // Back to the top until x31 is zero
+    return words;
+}
+
+static string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// Parse "<mode> --option value ..." into a mode name and a configuration
+static string parseCheckConfig(const string& text, PipelineConfig& config) {
+    stringstream ss(text);
+    string mode, option, value;
+    ss >> mode;
+    while (ss >> option >> value) {
+        bool ok = true;
+        if (option == "--l1i") ok = parseCacheSpec(value, config.l1i);
+        else if (option == "--l1d") ok = parseCacheSpec(value, config.l1d);
+        else if (option == "--predictor") ok = parsePredictorSpec(value, config.predictor);
+        else if (option == "--branch-stage") ok = parseBranchStage(value, config.branchStage);
+        else if (option == "--load-latency") config.loadLatency = stoi(value);
+        else if (option == "--branch-penalty") config.branchPenalty = stoi(value);
+        else if (option == "--width") config.issueWidth = stoi(value);
+        else if (option == "--ports") ok = parsePortSpec(value, config);
+        else if (option == "--pipeline") ok = parsePipelineLayout(value, config.layout);
+        else if (option == "--window") ok = parseOutOfOrderSpec(value, config.window);
+        else ok = false;
+        if (!ok) throw runtime_error("bad check configuration \"" + text + "\"");
+    }
+    return mode;
+}
+
+// The stalls tracetool reads from binary traces of deep and wide runs
+// against the '-' cells of the same runs' text diagrams, row by row
+static void checkTraceStalls(const filesystem::path& dir) {
+    auto file = [&](const char* name) { return (dir / name).string(); };
+    static const char* const setups[] = {
+        "forward --pipeline 8",
+        "noforward --pipeline IF,ID,RR,EX,EX2,MEM,MEM2,WB --load-latency 2",
+        "noforward --pipeline 7 --width 2",
+    };
+    vector<string> paths = listPrograms("../inputfiles");
+    for (uint32_t seed : {1u, 2u}) {
+        mt19937 rng(seed);
+        paths.push_back(file(("loop_" + to_string(seed) + ".txt").c_str()));
+        writeListing(paths.back(), randomProgram(rng));
+    }
+    int runs = 0;
+    size_t rows = 0;
+    for (const string& path : paths) {
+        Program program = loadProgram(path);
+        for (const char* setup : setups) {
+            RunOptions run;
+            const ModeEntry* mode = findMode(parseCheckConfig(setup, run.config));
+            run.start = initialState(program);
+            run.cycles = 5000;
+            run.path = file("trace.txt");
+            mode->run(program, run);
+            run.format = "binary";
+            run.path = file("trace.bin");
+            mode->run(program, run);
+
+            ifstream text(file("trace.txt"));
+            FILE* binary = fopen(file("trace.bin").c_str(), "rb");
+            if (!binary) throw runtime_error("Error opening " + file("trace.bin"));
+            BinaryTraceReader reader(binary);
+            StageRecord rec;
+            for (string line; getline(text, line); rows++) {
+                stringstream ss(line.substr(line.find(';') + 1));
+                int64_t want = 0, perStage[NUM_STAGES] = {};
+                for (string cell; getline(ss, cell, ';');) want += cell == "-";
+                if (!reader.next(rec) || stallCycles(rec, 0, INT64_MAX, perStage) != want) {
+                    fail(path + " (" + setup + "): traced stalls differ from the diagram row \"" + line + "\"");
+                    break;
+                }
+            }
+            fclose(binary);
+            runs++;
+        }
+    }
+    cout << "traced stalls: " << runs << " runs, " << rows << " rows" << endl;
+}
+
+static bool sameCache(const CacheStats& a, const CacheStats& b) {
+    return a.hits == b.hits && a.misses == b.misses && a.evictions == b.evictions && a.writebacks == b.writebacks;
+}
+
+static bool sameResult(const SimResult& a, const SimResult& b) {
+    return a.cycles == b.cycles && a.retired == b.retired && a.stall_cycles == b.stall_cycles &&
+           a.stall_causes == b.stall_causes &&
+           a.branch_bubbles == b.branch_bubbles && a.mem_stall_cycles == b.mem_stall_cycles &&
+           a.fetch_stall_cycles == b.fetch_stall_cycles && sameCache(a.l1i, b.l1i) && sameCache(a.l1d, b.l1d) &&
+           a.branches.branches == b.branches.branches && a.branches.mispredicts == b.branches.mispredicts &&
+           a.branches.btbMisses == b.branches.btbMisses && a.branches.returns == b.branches.returns &&
+           a.branches.returnMispredicts == b.branches.returnMispredicts && a.branches.indirect == b.branches.indirect &&
+           a.branches.indirectMispredicts == b.branches.indirectMispredicts;
+}
+
+// Restoring path into a processor started from state must be refused
+template <typename Policy = ForwardingPolicy>
+static void expectRefused(const Program& program, const ArchState& state, const string& path, const string& what) {
+    try {
+        Processor<Policy> processor(program, state);
+        processor.restoreCheckpoint(path);
+        fail("restored " + what);
+    } catch (const runtime_error&) {
+    }
+}
+
+// Every example program and two random loops, paused at a checkpoint and
+// resumed from it, in every mode: the two diagrams concatenate to the
+// uninterrupted diagram and the counters match it. Pausing twice at the
+// same cycle writes the same bytes, and checkpoints that do not fit the
+// processor are refused.
+static void checkCheckpoints(const filesystem::path& dir) {
+    namespace fs = std::filesystem;
+    vector<string> paths = listPrograms("../inputfiles");
+    if (paths.empty()) {
+        fail("no programs in ../inputfiles");
+        return;
+    }
+    auto file = [&](const char* name) { return (dir / name).string(); };
+    for (uint32_t seed : {1u, 2u}) {
+        mt19937 rng(seed);
+        paths.push_back(file(("loop_" + to_string(seed) + ".txt").c_str()));
+        writeListing(paths.back(), randomProgram(rng));
+    }
+
+    int pauses = 0;
+    for (const string& path : paths) {
+        Program program = loadProgram(path);
+        // The default timing, and one where branches and loads span cycles,
+        // both caches miss and a small predictor speculates
+        PipelineConfig slow;
+        slow.branchStage = STAGE_EX;
+        slow.branchPenalty = 1;
+        slow.loadLatency = 3;
+        parseCacheSpec("size=64,ways=2,line=8,repl=random,penalty=4", slow.l1i);
+        parseCacheSpec("size=64,ways=2,line=8,penalty=6", slow.l1d);
+        parsePredictorSpec("gshare,btb=16,bits=6,history=6,ras=2,indirect=4", slow.predictor);
+        // And the slow timing issued two wide, and eight stages deep, on
+        // the slot pipeline
+        PipelineConfig wide = slow, deep = slow;
+        wide.issueWidth = 2;
+        parsePipelineLayout("8", deep.layout);
+        vector<tuple<const ModeEntry*, PipelineConfig, const char*>> setups;
+        for (const ModeEntry& mode : allModes()) {
+            setups.push_back({&mode, PipelineConfig(), ""});
+            setups.push_back({&mode, slow, ", slow"});
+            setups.push_back({&mode, wide, ", wide"});
+            setups.push_back({&mode, deep, ", deep"});
+        }
+        for (auto& [mode, config, label] : setups) {
+            RunOptions full;
+            full.start = initialState(program);
+            full.config = config;
+            full.cycles = 5000;
+            full.path = file("full.txt");
+            SimResult whole = mode->run(program, full);
+            string wholeText = readFile(full.path);
+            string where = path + " (" + mode->name + label + ")";
+
+            // Every cycle of short runs, so each hazard and branch is cut
+            // once, and 30 evenly spaced cycles of the long loops
+            uint64_t step = whole.cycles > 300 ? whole.cycles / 30 : 1;
+            for (uint64_t at = 1; at < whole.cycles; at += step) {
+                RunOptions first = full;
+                first.path = file("first.txt");
+                first.checkpointPath = file("a.ckpt");
+                first.checkpointAt = at;
+                SimResult paused = mode->run(program, first);
+                RunOptions again = first;
+                again.checkpointPath = file("b.ckpt");
+                mode->run(program, again);
+                RunOptions second = full;
+                second.path = file("second.txt");
+                second.restorePath = first.checkpointPath;
+                SimResult resumed = mode->run(program, second);
+
+                string when = " paused at " + to_string(at);
+                if (!paused.paused || paused.cycles != at) fail(where + " did not pause at " + to_string(at));
+                if (readFile(first.path) + readFile(second.path) != wholeText) fail(where + when + ": diagram differs");
+                if (!sameResult(resumed, whole)) fail(where + when + ": counters differ");
+                if (readFile(first.checkpointPath) != readFile(again.checkpointPath)) fail(where + when + ": checkpoints differ");
+                pauses++;
+            }
+        }
+
+        // Checkpoints that do not fit: one from the other core, a cut-off
+        // file, and a register file that is not 32 entries
+        RunOptions run;
+        run.start = initialState(program);
+        run.cycles = 5000;
+        run.checkpointPath = file("a.ckpt");
+        run.checkpointAt = 3;
+        findMode(ForwardingPolicy::name)->run(program, run);
+        ArchState fewerRegisters = run.start;
+        fewerRegisters.registers.pop_back();
+        expectRefused<NoForwardingPolicy>(program, run.start, run.checkpointPath, "a forward checkpoint in noforward mode");
+        fs::resize_file(run.checkpointPath, fs::file_size(run.checkpointPath) - 1);
+        expectRefused(program, run.start, run.checkpointPath, "a truncated checkpoint");
+        Processor<ForwardingPolicy> odd(program, fewerRegisters);
+        odd.saveCheckpoint(run.checkpointPath);
+        expectRefused(program, run.start, run.checkpointPath, "a checkpoint with 31 registers");
+    }
+    cout << "checkpoints: " << paths.size() << " programs, " << pauses << " pauses" << endl;
+}
+
+// Every example program and two random loops with long cache misses, in
+// every mode, also two wide and eight stages deep: a run that skips idle
+// cycles writes the same diagram, profile, counters and window occupancy
+// as one at --trace cycle, which ticks through every cycle
+static void checkIdleSkipping(const filesystem::path& dir) {
+    // Where the cycle trace goes
+    struct NullBuffer : streambuf {
+        int overflow(int c) override { return c; }
+    };
+    auto file = [&](const char* name) { return (dir / name).string(); };
+    vector<string> paths = listPrograms("../inputfiles");
+    for (uint32_t seed : {1u, 2u}) {
+        mt19937 rng(seed);
+        paths.push_back(file(("loop_" + to_string(seed) + ".txt").c_str()));
+        writeListing(paths.back(), randomProgram(rng));
+    }
+    PipelineConfig slow;
+    slow.loadLatency = 4;
+    parseCacheSpec("size=64,ways=2,line=8,penalty=40", slow.l1i);
+    parseCacheSpec("size=64,ways=2,line=8,penalty=60", slow.l1d);
+    parsePredictorSpec("bimodal,btb=16", slow.predictor);
+    PipelineConfig wide = slow, deep = slow;
+    wide.issueWidth = 2;
+    parsePipelineLayout("8", deep.layout);
+    const pair<const char*, PipelineConfig> setups[] = {{"", slow}, {", wide", wide}, {", deep", deep}};
+
+    int runs = 0;
+    NullBuffer null;
+    for (const string& path : paths) {
+        Program program = loadProgram(path);
+        for (const ModeEntry& mode : allModes()) {
+            for (auto& [label, config] : setups) {
+                RunOptions skipping;
+                skipping.start = initialState(program);
+                skipping.config = config;
+                skipping.cycles = 20000;
+                skipping.path = file("skipping.txt");
+                skipping.profilePath = file("skipping");
+                SimResult skipped = mode.run(program, skipping);
+                RunOptions ticking = skipping;
+                ticking.level = TraceLevel::Cycle;
+                ticking.path = file("ticking.txt");
+                ticking.profilePath = file("ticking");
+                streambuf* out = cout.rdbuf(&null);
+                SimResult ticked = mode.run(program, ticking);
+                cout.rdbuf(out);
+
+                string where = path + " (" + mode.name + label + ")";
+                if (!sameResult(skipped, ticked) || skipped.occupancy != ticked.occupancy) {
+                    fail(where + ": counters differ when idle cycles are skipped");
+                }
+                if (readFile(skipping.path) != readFile(ticking.path)) fail(where + ": diagram differs when idle cycles are skipped");
+                if (readFile(file("skipping.folded")) != readFile(file("ticking.folded")) ||
+                    readFile(file("skipping.top.txt")) != readFile(file("ticking.top.txt"))) {
+                    fail(where + ": profile differs when idle cycles are skipped");
+                }
+                runs++;
+            }
+        }
+    }
+    cout << "idle skipping: " << runs << " runs" << endl;
+}
+
+// Stall causes of kernels whose hazards are known by hand, then every input
+// program: its causes add up to its stalls, and the JSON and CSV counters
+// files carry each counter of each run.
+struct CounterKernel {
+    const char* name;
+    vector<uint32_t> words;
+    Stage branchStage;
+    int issueWidth;
+    array<uint64_t, NUM_STALL_CAUSES> forward, noforward; // Stalls by cause; STALL_NONE is not checked
+};
+
+static void checkCounters(const filesystem::path& dir) {
+    auto file = [&](const char* name) { return (dir / name).string(); };
+    const uint32_t opImm = 0x13, load = 0x03, beq = 0x0;
+    const CounterKernel kernels[] = {
+        // An add of a loaded value: one load-use stall with forwarding, and
+        // without it a cycle each behind the load in EX and in MEM
+        {"load-use", {encodeI(0, 0, 0x2, 1, load), encodeR(0, 1, 1, 0x0, 2)}, STAGE_ID, 1, {0, 1, 0, 0, 0, 0}, {0, 0, 1, 1, 0, 0}},
+        // A branch in ID on the value being computed in EX
+        {"branch operand", {encodeI(1, 0, 0x0, 1, opImm), encodeB(8, 0, 1, beq), encodeI(1, 0, 0x0, 2, opImm)}, STAGE_ID, 1,
+         {0, 0, 0, 0, 1, 0}, {0, 0, 1, 1, 0, 1}},
+        // A branch resolving in EX with no operand hazard
+        {"branch in EX", {encodeB(8, 0, 0, beq), encodeI(1, 0, 0x0, 2, opImm), encodeI(1, 0, 0x0, 3, opImm)}, STAGE_EX, 1,
+         {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 1}},
+        // Two wide: two loads fetched together with one memory port, and
+        // an add that reaches decode in the same group as the addi it uses
+        {"port and pairing",
+         {encodeI(0, 0, 0x2, 3, load), encodeI(4, 0, 0x2, 4, load), encodeI(0, 0, 0x0, 5, opImm),
+          encodeI(1, 0, 0x0, 1, opImm), encodeR(0, 1, 1, 0x0, 2)},
+         STAGE_ID, 2, {0, 0, 0, 0, 0, 0, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 1}},
+    };
+    for (const CounterKernel& kernel : kernels) {
+        writeListing(file("kernel.txt"), kernel.words);
+        Program program = loadProgram(file("kernel.txt"));
+        for (const ModeEntry& mode : allModes()) {
+            RunOptions run;
+            run.start = initialState(program);
+            run.config.branchStage = kernel.branchStage;
+            run.config.issueWidth = kernel.issueWidth;
+            run.cycles = 100;
+            SimResult r = mode.run(program, run);
+            // The out-of-order core dispatches past all of these into a window
+            // they cannot fill, so it counts no stalls at all
+            const array<uint64_t, NUM_STALL_CAUSES> none{};
+            const auto& want = string(mode.name) == OutOfOrderProcessor::name ? none
+                               : string(mode.name) == ForwardingPolicy::name ? kernel.forward
+                                                                              : kernel.noforward;
+            for (int cause = STALL_NONE + 1; cause < NUM_STALL_CAUSES; cause++) {
+                if (r.stall_causes[cause] != want[cause]) {
+                    fail(string(kernel.name) + " (" + mode.name + "): " + to_string(r.stall_causes[cause]) + " " +
+                         stallCauseNames[cause] + " stalls, expected " + to_string(want[cause]));
+                }
+            }
+        }
+    }
+
+    vector<string> paths = listPrograms("../inputfiles");
+    int runs = 0;
+    for (const string& path : paths) {
+        Program program = loadProgram(path);
+        PipelineConfig config;
+        config.loadLatency = 2;
+        parseCacheSpec("size=64,ways=2,line=8,penalty=6", config.l1d);
+        parsePredictorSpec("bimodal,btb=16", config.predictor);
+        vector<pair<string, SimResult>> results;
+        for (const ModeEntry& mode : allModes()) {
+            RunOptions run;
+            run.start = initialState(program);
+            run.config = config;
+            run.cycles = 5000;
+            SimResult r = mode.run(program, run);
+            uint64_t byCause = accumulate(r.stall_causes.begin() + STALL_NONE + 1, r.stall_causes.end(), uint64_t(0));
+            if (byCause != r.stall_cycles) {
+                fail(path + " (" + mode.name + "): stall causes add up to " + to_string(byCause) + " of " +
+                     to_string(r.stall_cycles) + " stalls");
+            }
+            results.push_back({mode.name, r});
+            runs++;
+        }
+
+        // What each counter must read, taken from the results rather than
+        // from perfCounters()
+        auto expected = [](const SimResult& r) {
+            vector<pair<string, uint64_t>> want = {{"cycles", r.cycles}, {"instructions", r.retired},
+                                                   {"stall_cycles", r.stall_cycles}};
+            for (int cause = STALL_NONE + 1; cause < NUM_STALL_CAUSES; cause++) {
+                want.push_back({string("stall_") + stallCauseNames[cause], r.stall_causes[cause]});
+            }
+            want.insert(want.end(), {{"branch_bubbles", r.branch_bubbles}, {"mem_stall_cycles", r.mem_stall_cycles},
+                                     {"fetch_stall_cycles", r.fetch_stall_cycles}, {"l1d_hits", r.l1d.hits},
+                                     {"l1d_misses", r.l1d.misses}, {"l1d_evictions", r.l1d.evictions},
+                                     {"l1d_writebacks", r.l1d.writebacks}, {"l1i_misses", r.l1i.misses},
+                                     {"branches", r.branches.branches}, {"branch_mispredicts", r.branches.mispredicts},
+                                     {"conditional_branches", r.branches.conditional},
+                                     {"conditional_mispredicts", r.branches.conditionalMispredicts},
+                                     {"btb_misses", r.branches.btbMisses}, {"returns", r.branches.returns},
+                                     {"indirect_jumps", r.branches.indirect}});
+            return want;
+        };
+        auto compare = [&](const string& mode, const SimResult& r, map<string, string>& got, const char* format) {
+            for (auto& [name, value] : expected(r)) {
+                if (got[name] != to_string(value)) {
+                    fail(path + " (" + mode + "): counters " + format + " has " + name + " " + got[name] + ", expected " +
+                         to_string(value));
+                }
+            }
+        };
+
+        // Each run's "counters" object, which holds only numbers
+        writeCounters(file("counters.json"), path, config, results);
+        string json = readFile(file("counters.json"));
+        static const regex counter("\"(\\w+)\": ([0-9.]+)");
+        size_t at = 0;
+        for (auto& [mode, r] : results) {
+            at = json.find("\"counters\": {", json.find("\"mode\": \"" + mode + "\"", at));
+            size_t end = json.find('}', at);
+            map<string, string> got;
+            for (sregex_iterator m(json.begin() + at, json.begin() + end, counter), last; m != last; ++m) {
+                got[(*m)[1]] = (*m)[2];
+            }
+            compare(mode, r, got, "JSON");
+        }
+
+        writeCounters(file("counters.csv"), path, config, results);
+        ifstream csv(file("counters.csv"));
+        auto cells = [](const string& line) {
+            vector<string> out;
+            stringstream ss(line);
+            for (string cell; getline(ss, cell, ';');) out.push_back(cell);
+            return out;
+        };
+        string line;
+        getline(csv, line);
+        vector<string> header = cells(line);
+        for (auto& [mode, r] : results) {
+            getline(csv, line);
+            vector<string> row = cells(line);
+            if (row.size() != header.size() || row[0] != path || row[1] != mode) {
+                fail(path + " (" + mode + "): counters CSV row is " + line);
+                continue;
+            }
+            map<string, string> got;
+            for (size_t i = 0; i < row.size(); i++) got[header[i]] = row[i];
+            compare(mode, r, got, "CSV");
+        }
+    }
+    cout << "counters: " << size(kernels) << " kernels, " << runs << " runs" << endl;
+}
+
+// Every core and configuration each random program runs on, as the
+// simulator's own options
+static const char* const checkConfigs[] = {
+    "forward",
+    "noforward",
+    "forward --branch-stage ex --load-latency 3 --branch-penalty 1",
+    "noforward --branch-stage ex --load-latency 2",
+    "forward --branch-penalty 1 --load-latency 2",
+    "noforward --l1i size=256,ways=2,line=16,penalty=10 --l1d size=256,ways=1,line=16,write=through,penalty=7",
+    "forward --l1i size=512,line=16,penalty=6 --l1d size=512,ways=2,repl=random,penalty=12",
+    "forward --l1d size=256,ways=2,line=16,repl=fifo,penalty=9 --load-latency 2",
+    "forward --predictor gshare,btb=64,bits=8,history=8 --l1i size=512,line=16,penalty=6",
+    "noforward --predictor bimodal --branch-stage ex",
+    "forward --predictor btfn --branch-stage ex --load-latency 3",
+    "noforward --predictor nottaken --branch-penalty 1",
+    "forward --predictor tage,ras=2,indirect=4 --branch-stage ex",
+    "forward --width 2 --predictor bimodal",
+    "noforward --width 4 --ports mem=2,branch=2 --l1d size=256,penalty=9",
+    "forward --width 4 --branch-stage ex --predictor btfn --l1i size=256,line=16,penalty=5",
+    "forward --width 2 --branch-penalty 1 --load-latency 2",
+    "forward --pipeline 8 --predictor gshare",
+    "noforward --pipeline 7 --l1d size=256,penalty=9",
+    "forward --width 2 --pipeline 8 --branch-stage ex --predictor btfn",
+    "noforward --width 4 --pipeline 7 --ports mem=2,branch=2",
+    "forward --pipeline IF,ID,RR,EX,EX2,MEM,WB --load-latency 2",
+    "ooo",
+    "ooo --width 4 --window rob=8,iq=4,lsq=2,prf=40 --l1i size=256,line=16,penalty=7 --l1d size=256,penalty=11 --predictor gshare",
+    "ooo --width 2 --predictor none --load-latency 3",
+    "ooo --window rob=4,iq=2,lsq=1,prf=33 --predictor tage,ras=2,indirect=4 --ports mem=1,branch=1",
+};
+
+static bool sameState(const ArchState& a, const ArchState& b) {
+    return a.registers == b.registers && a.dataMemory == b.dataMemory && a.pc == b.pc;
+}
+
+// What differs between a state and the reference, for the report
+static string stateDiff(const ArchState& got, const ArchState& want) {
+    stringstream ss;
+    if (got.pc != want.pc) ss << " pc 0x" << hex << got.pc << " (want 0x" << want.pc << ")" << dec;
+    for (int r = 0; r < 32; r++) {
+        if (got.registers[r] != want.registers[r]) {
+            ss << " x" << r << "=0x" << hex << got.registers[r] << " (want 0x" << want.registers[r] << ")" << dec;
+            break;
+        }
+    }
+    if (!(got.dataMemory == want.dataMemory)) ss << " data memory differs";
+    return ss.str();
+}
+
+// Cycles a core may take; far more than any generated program needs
+static const uint64_t checkCycles = 50000000;
+
+template <typename Core>
+static ArchState finalState(const Program& program, const ArchState& start, const PipelineConfig& config) {
+    Core core(program, start, config);
+    NullDiagramWriter writer;
+    SimResult result = core.simulate(checkCycles, writer, TraceLevel::Off);
+    if (result.cycles >= checkCycles) throw runtime_error("ran out of cycles");
+    return core.archState();
+}
+
+// The in-order core the simulator picks for config, as runMode() does
+template <typename Policy>
+static ArchState finalInOrderState(const Program& program, const ArchState& start, const PipelineConfig& config) {
+    if (!config.classic()) return finalState<SlotPipeline<Policy>>(program, start, config);
+    return finalState<Processor<Policy>>(program, start, config);
+}
+
+// Differential check: random RV32I programs are run to the end by
+// FunctionalSim::step(), the reference, then by its translated run() and
+// runTo(), whole and in slices, and by every core in a range of
+// configurations. Each must finish in the same architectural state:
+// registers, data memory and pc. Odd-numbered programs hand a core the
+// state after a random functional prefix, as --skip does. Any difference
+// is printed with the program's seed, which --seed and --programs 1
+// reproduce.
+static void checkDifferential(const filesystem::path& dir, int programs, uint32_t seed, bool keep) {
+    vector<pair<string, PipelineConfig>> configs;
+    for (const char* text : checkConfigs) {
+        PipelineConfig config;
+        string mode = parseCheckConfig(text, config);
+        configs.emplace_back(mode, config);
+    }
+
+    uint64_t runs = 0, instructions = 0;
+    for (int n = 0; n < programs; n++) {
+        uint32_t programSeed = seed + uint32_t(n);
+        mt19937 rng(programSeed);
+        string path = (dir / ("check_" + to_string(programSeed) + ".txt")).string();
+        writeListing(path, randomProgram(rng));
+        Program program = loadProgram(path);
+        auto mismatch = [&](const string& what, const string& detail) {
+            fail("seed " + to_string(programSeed) + ": " + what + ":" + detail);
+        };
+
+        FunctionalSim reference(program);
+        while (!reference.done()) reference.step();
+        const ArchState& want = reference.archState();
+        instructions += reference.instructions();
+
+        // The translated blocks of run() and runTo(), in one go and in
+        // random slices that end inside blocks and at random pcs
+        FunctionalSim whole(program), sliced(program);
+        whole.run(UINT64_MAX);
+        while (!sliced.done()) {
+            if (rng() % 2) sliced.runTo(program.base + 4 * uint32_t(rng() % program.instrMemory.size()), 1 + rng() % 500);
+            else sliced.run(1 + rng() % 200);
+        }
+        for (FunctionalSim* sim : {&whole, &sliced}) {
+            const char* what = sim == &whole ? "run()" : "run()/runTo() slices";
+            if (sim->instructions() != reference.instructions()) {
+                mismatch(what, " " + to_string(sim->instructions()) + " instructions, expected " + to_string(reference.instructions()));
+            } else if (!sameState(sim->archState(), want)) {
+                mismatch(what, stateDiff(sim->archState(), want));
+            }
+        }
+
+        // Cores start at the beginning, or after a functional prefix
+        FunctionalSim prefix(program);
+        if (n % 2) prefix.run(rng() % (reference.instructions() + 1));
+        for (size_t c = 0; c < configs.size(); c++) {
+            const auto& [mode, config] = configs[c];
+            ArchState got;
+            try {
+                if (mode == ForwardingPolicy::name) got = finalInOrderState<ForwardingPolicy>(program, prefix.archState(), config);
+                else if (mode == OutOfOrderProcessor::name) got = finalState<OutOfOrderProcessor>(program, prefix.archState(), config);
+                else got = finalInOrderState<NoForwardingPolicy>(program, prefix.archState(), config);
+            } catch (const exception& e) {
+                mismatch(checkConfigs[c], string(" ") + e.what());
+                continue;
+            }
+            if (!sameState(got, want)) mismatch(checkConfigs[c], stateDiff(got, want));
+            runs++;
+        }
+        if (!keep) filesystem::remove(path);
+    }
+    cout << "differential: " << programs << " programs (" << instructions << " instructions), " << runs
+         << " runs over " << size(checkConfigs) << " configurations" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    int programs = 300;
+    uint32_t seed = 1;
+    string keepDir;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        try {
+            if (arg == "--programs") programs = stoi(value);
+            else if (arg == "--seed") seed = uint32_t(stoul(value));
+            else if (arg == "--keep") keepDir = value;
+            else throw invalid_argument(arg);
+        } catch (const exception&) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    namespace fs = std::filesystem;
+    fs::path scratch = keepDir.empty() ? fs::temp_directory_path() / ("riscv_check_" + to_string(getpid())) : fs::path(keepDir);
+    try {
+        fs::create_directories(scratch);
+        checkDiagramRows();
+        checkBinaryTrace();
+        checkTraceStalls(scratch);
+        checkCheckpoints(scratch);
+        checkIdleSkipping(scratch);
+        checkCounters(scratch);
+        checkDifferential(scratch, programs, seed, !keepDir.empty());
+    } catch (const exception& e) {
+        fail(e.what());
+    }
+    if (keepDir.empty()) fs::remove_all(scratch);
+    cout << (failures ? to_string(failures) + " failure(s)" : "all checks passed") << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "tracefile.hpp"
+#include "mappedfile.hpp"
+#include "memory.hpp"
+
+using namespace std;
+
+// Processor checkpoint, version 8. Little-endian, written by
+// Processor::saveCheckpoint() (or SlotPipeline's) and read back by
+// restoreCheckpoint():
+//
+//   char[8]  "RVPCKPT\0"
+//   u16      version
+//   u16      reserved (0)
+//   varint   length + bytes of the hazard policy name, plus the issue
+//            width and stages of a SlotPipeline ("forward, 2-wide, IF,ID,EX,MEM,WB")
+//   u64      FNV-1a hash of the instruction memory, u32 instruction count
+//   ...      processor fields in the order Processor::checkpointFields()
+//            visits them: fixed-width scalars, u32-counted arrays, data
+//            memory as a u32 page count followed by (u32 page number, 4 KiB)
+//            for every allocated page, u32-length-prefixed sections that a
+//            reader may skip, and the in-flight diagram records
+//
+// Structs are written member by member through their own checkpointFields(),
+// never as raw bytes, so the file does not depend on padding or on how the
+// compiler lays the structs out.
+
+static const char checkpointMagic[8] = {'R', 'V', 'P', 'C', 'K', 'P', 'T', '\0'};
+static const uint16_t checkpointVersion = 8;
+
+inline uint64_t programHash(const vector<uint32_t>& instrMemory) {
+    uint64_t h = 1469598103934665603ull;
+    for (uint32_t word : instrMemory) {
+        for (int i = 0; i < 4; i++) {
+            h ^= (word >> (8 * i)) & 0xFF;
+            h *= 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+// std::array members go element by element, like C arrays
+template <typename T> struct isStdArray : false_type {};
+template <typename T, size_t N> struct isStdArray<array<T, N>> : true_type {};
+
+// Accumulates a checkpoint in memory and writes it with one fwrite
+class CheckpointWriter {
+    vector<uint8_t> buf;
+public:
+    // Integers, enums and bools at their own width, fixed-size arrays
+    // element by element, and structs through T::checkpointFields()
+    template <typename T>
+    void field(const T& v) {
+        if constexpr (is_integral<T>::value || is_enum<T>::value) {
+            putLE<T>(buf, v);
+        } else if constexpr (is_array<T>::value || isStdArray<T>::value) {
+            for (const auto& x : v) field(x);
+        } else {
+            T::checkpointFields(*this, v);
+        }
+    }
+
+    // The count the reader checks against is its own business
+    template <typename T>
+    void array(const vector<T>& v, size_t = SIZE_MAX) {
+        putLE<uint32_t>(buf, uint32_t(v.size()));
+        for (const T& x : v) field(x);
+    }
+
+    void memory(const PagedMemory& mem) {
+        putLE<uint32_t>(buf, uint32_t(mem.pageCount()));
+        mem.forEachPage([&](uint32_t page, const uint8_t* data) {
+            putLE<uint32_t>(buf, page);
+            buf.insert(buf.end(), data, data + PagedMemory::pageSize);
+        });
+    }
+
+    // Fields written by body, behind their length so a reader can skip them
+    template <typename F>
+    void section(F body) {
+        size_t at = buf.size();
+        putLE<uint32_t>(buf, 0);
+        body();
+        vector<uint8_t> length;
+        putLE<uint32_t>(length, uint32_t(buf.size() - at - 4));
+        copy(length.begin(), length.end(), buf.begin() + at);
+    }
+    void skipSection() {}
+
+    void text(const string& s) {
+        putVarint(buf, s.size());
+        buf.insert(buf.end(), s.begin(), s.end());
+    }
+
+    void magic() {
+        buf.insert(buf.end(), checkpointMagic, checkpointMagic + 8);
+        putLE<uint16_t>(buf, checkpointVersion);
+        putLE<uint16_t>(buf, 0);
+    }
+
+    // Write to a temporary file and rename it into place, so a crash while
+    // saving never leaves a torn checkpoint behind
+    void save(const string& path) const {
+        string tmp = path + ".tmp";
+        FILE* file = fopen(tmp.c_str(), "wb");
+        if (!file) {
+            throw runtime_error("Error opening " + tmp);
+        }
+        bool ok = fwrite(buf.data(), 1, buf.size(), file) == buf.size();
+        ok = (fclose(file) == 0) && ok;
+        if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+            throw runtime_error("Error writing checkpoint " + path);
+        }
+    }
+};
+
+// Maps a checkpoint read-only and walks it in place
+class CheckpointReader {
+    MappedFile file;
+    const uint8_t* p = nullptr;
+    const uint8_t* end = nullptr;
+
+    void need(size_t n) {
+        if (size_t(end - p) < n) throw runtime_error("truncated checkpoint");
+    }
+
+public:
+    explicit CheckpointReader(const string& path) : file(path) {
+        p = file.data();
+        end = p + file.size();
+    }
+
+    template <typename T>
+    void field(T& v) {
+        if constexpr (is_integral<T>::value || is_enum<T>::value) {
+            need(sizeof(T));
+            v = getLE<T>(p);
+            p += sizeof(T);
+        } else if constexpr (is_array<T>::value || isStdArray<T>::value) {
+            for (auto& x : v) field(x);
+        } else {
+            T::checkpointFields(*this, v);
+        }
+    }
+
+    // A u32-counted array; with expect given, any other count is an error
+    template <typename T>
+    void array(vector<T>& v, size_t expect = SIZE_MAX) {
+        need(4);
+        uint32_t n = getLE<uint32_t>(p);
+        p += 4;
+        if (expect != SIZE_MAX && n != expect) {
+            throw runtime_error("checkpoint holds " + to_string(n) + " entries where " + to_string(expect) + " belong");
+        }
+        need(n); // Every entry takes at least a byte, so a bad count cannot allocate past the file
+        v.resize(n);
+        for (T& x : v) field(x);
+    }
+
+    void memory(PagedMemory& mem) {
+        need(4);
+        uint32_t n = getLE<uint32_t>(p);
+        p += 4;
+        mem.clear();
+        for (uint32_t i = 0; i < n; i++) {
+            need(4 + PagedMemory::pageSize);
+            uint32_t page = getLE<uint32_t>(p);
+            if (page >= (1u << (32 - PagedMemory::pageBits))) throw runtime_error("corrupt checkpoint page number");
+            mem.write(page << PagedMemory::pageBits, p + 4, PagedMemory::pageSize);
+            p += 4 + PagedMemory::pageSize;
+        }
+    }
+
+    // Read a section written by CheckpointWriter::section(); body may stop
+    // early with skipSection()
+    template <typename F>
+    void section(F body) {
+        need(4);
+        uint32_t n = getLE<uint32_t>(p);
+        p += 4;
+        need(n);
+        const uint8_t* outer = end;
+        end = p + n;
+        body();
+        p = end;
+        end = outer;
+    }
+    void skipSection() { p = end; }
+
+    void text(string& s) {
+        uint64_t n = getVarint(p, end);
+        need(n);
+        s.assign(reinterpret_cast<const char*>(p), n);
+        p += n;
+    }
+
+    void magic() {
+        need(12);
+        if (memcmp(p, checkpointMagic, 8) != 0) throw runtime_error("not a processor checkpoint");
+        uint16_t version = getLE<uint16_t>(p + 8);
+        if (version != checkpointVersion) throw runtime_error("unsupported checkpoint version " + to_string(version));
+        p += 12;
+    }
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "pipeline.hpp"
+
+using namespace std;
+
+// Hardware-style performance counters of finished runs, as JSON or CSV for
+// dashboards. Every run reports the same counters in the same order, zero
+// where a feature (cache, predictor) was off, so files from different
+// configurations line up.
+
+// The counters of one run as (name, value) pairs, values already formatted
+inline vector<pair<string, string>> perfCounters(const SimResult& r) {
+    vector<pair<string, string>> c;
+    auto add = [&](const string& name, uint64_t value) { c.emplace_back(name, to_string(value)); };
+    auto ratio = [&](const string& name, double value) {
+        ostringstream out;
+        out << fixed << setprecision(4) << value;
+        c.emplace_back(name, out.str());
+    };
+    add("cycles", r.cycles);
+    add("instructions", r.retired);
+    ratio("cpi", r.retired ? double(r.cycles) / r.retired : 0.0);
+    ratio("ipc", r.cycles ? double(r.retired) / r.cycles : 0.0);
+    add("stall_cycles", r.stall_cycles);
+    for (int cause = STALL_NONE + 1; cause < NUM_STALL_CAUSES; cause++) {
+        add(string("stall_") + stallCauseNames[cause], r.stall_causes[cause]);
+    }
+    add("branch_bubbles", r.branch_bubbles);
+    add("mem_stall_cycles", r.mem_stall_cycles);
+    add("fetch_stall_cycles", r.fetch_stall_cycles);
+    for (auto [name, cache] : {pair{"l1i", &r.l1i}, pair{"l1d", &r.l1d}}) {
+        add(string(name) + "_hits", cache->hits);
+        add(string(name) + "_misses", cache->misses);
+        add(string(name) + "_evictions", cache->evictions);
+        add(string(name) + "_writebacks", cache->writebacks);
+    }
+    add("branches", r.branches.branches);
+    add("branch_mispredicts", r.branches.mispredicts);
+    add("conditional_branches", r.branches.conditional);
+    add("conditional_mispredicts", r.branches.conditionalMispredicts);
+    add("btb_misses", r.branches.btbMisses);
+    add("returns", r.branches.returns);
+    add("return_mispredicts", r.branches.returnMispredicts);
+    add("indirect_jumps", r.branches.indirect);
+    add("indirect_mispredicts", r.branches.indirectMispredicts);
+    for (int k = 0; k < NUM_WINDOWS; k++) ratio(string(windowNames[k]) + "_occupancy", meanOccupancy(r.occupancy[k]));
+    return c;
+}
+
+// The timing parameters a run used, as (name, value) pairs
+inline vector<pair<string, string>> configFields(const PipelineConfig& config) {
+    return {
+        {"branch_stage", stageNames[config.branchStage]},
+        {"branch_penalty", to_string(config.branchPenalty)},
+        {"load_latency", to_string(config.loadLatency)},
+        {"l1i_size", to_string(config.l1i.size)},
+        {"l1d_size", to_string(config.l1d.size)},
+        {"predictor", predictorNames[int(config.predictor.kind)]},
+        {"pipeline", layoutName(config.layout)},
+        {"issue_width", to_string(config.issueWidth)},
+        {"mem_ports", to_string(config.memPorts)},
+        {"branch_units", to_string(config.branchUnits)},
+        {"rob_entries", to_string(config.window.robEntries)},
+        {"iq_entries", to_string(config.window.iqEntries)},
+        {"lsq_entries", to_string(config.window.lsqEntries)},
+        {"phys_regs", to_string(config.window.physRegs)},
+    };
+}
+
+inline string jsonString(const string& s) {
+    string out = "\"";
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (uint8_t(ch) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof escaped, "\\u%04x", ch);
+            out += escaped;
+        } else {
+            out += ch;
+        }
+    }
+    return out + "\"";
+}
+
+// {"program": ..., "runs": [{"mode": ..., "config": {...}, "counters": {...}}, ...]}
+// Strings stay quoted in "config"; counters are all numbers. Out-of-order
+// runs add "occupancy": {"rob": [cycles at 0, at 1, ...], ...}.
+inline void writeCountersJson(ostream& out, const string& program, const PipelineConfig& config,
+                              const vector<pair<string, SimResult>>& runs) {
+    out << "{\n  \"program\": " << jsonString(program) << ",\n  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); i++) {
+        out << (i ? "," : "") << "\n    {\n      \"mode\": " << jsonString(runs[i].first) << ",\n      \"config\": {";
+        const char* sep = "";
+        for (auto& [name, value] : configFields(config)) {
+            bool number = !value.empty() && value.find_first_not_of("0123456789") == string::npos;
+            out << sep << "\"" << name << "\": " << (number ? value : jsonString(value));
+            sep = ", ";
+        }
+        out << "},\n      \"counters\": {";
+        sep = "\n";
+        for (auto& [name, value] : perfCounters(runs[i].second)) {
+            out << sep << "        \"" << name << "\": " << value;
+            sep = ",\n";
+        }
+        out << "\n      }";
+        // The out-of-order core's cycles per occupancy of each structure
+        const SimResult& r = runs[i].second;
+        if (!r.occupancy[WINDOW_ROB].empty()) {
+            out << ",\n      \"occupancy\": {";
+            sep = "\n";
+            for (int k = 0; k < NUM_WINDOWS; k++) {
+                out << sep << "        \"" << windowNames[k] << "\": [";
+                for (size_t n = 0; n < r.occupancy[k].size(); n++) out << (n ? ", " : "") << r.occupancy[k][n];
+                out << "]";
+                sep = ",\n";
+            }
+            out << "\n      }";
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// A header row, then one row per run: program;mode;<config>;<counters>
+inline void writeCountersCsv(ostream& out, const string& program, const PipelineConfig& config,
+                             const vector<pair<string, SimResult>>& runs) {
+    vector<pair<string, string>> fields = configFields(config);
+    out << "program;mode";
+    for (auto& field : fields) out << ";" << field.first;
+    for (auto& counter : perfCounters(SimResult())) out << ";" << counter.first;
+    out << "\n";
+    for (auto& [mode, result] : runs) {
+        out << program << ";" << mode;
+        for (auto& field : fields) out << ";" << field.second;
+        for (auto& counter : perfCounters(result)) out << ";" << counter.second;
+        out << "\n";
+    }
+}
+
+// Write the counters of runs to path: CSV if it ends in .csv, else JSON
+inline void writeCounters(const string& path, const string& program, const PipelineConfig& config,
+                          const vector<pair<string, SimResult>>& runs) {
+    ofstream out(path);
+    if (!out.is_open()) {
+        throw runtime_error("Error opening " + path);
+    }
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        writeCountersCsv(out, program, config, runs);
+    } else {
+        writeCountersJson(out, program, config, runs);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "mappedfile.hpp"
+
+using namespace std;
+
+// Initial contents of one allocated data section. bytes is empty for
+// .bss-style sections, which only reserve zeroed space.
+struct DataSegment {
+    uint32_t addr = 0;
+    uint32_t size = 0;
+    vector<uint8_t> bytes;
+};
+
+// What the simulator takes from a statically linked RV32 executable
+struct ElfImage {
+    uint32_t textBase = 0;      // Address of the first instruction word
+    vector<uint32_t> text;      // Executable sections, gaps filled with 0
+    uint32_t entry = 0;
+    vector<DataSegment> data;   // Every other allocated section
+    map<uint32_t, string> symbols; // Function and label symbols by address
+};
+
+inline bool isElf(const uint8_t* p, size_t size) {
+    return size >= 4 && p[0] == 0x7F && p[1] == 'E' && p[2] == 'L' && p[3] == 'F';
+}
+
+// ELF32 little-endian field readers
+inline uint16_t elf16(const uint8_t* p) { return uint16_t(p[0] | p[1] << 8); }
+inline uint32_t elf32(const uint8_t* p) { return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24; }
+
+// Parse an RV32 ELF executable straight out of its mapping
+inline ElfImage parseElf(const uint8_t* p, size_t size, const string& path) {
+    auto fail = [&](const string& why) { return runtime_error(path + ": " + why); };
+    if (!isElf(p, size) || size < 52) throw fail("not an ELF file");
+    if (p[4] != 1) throw fail("not a 32-bit ELF file (RV32 expected)");
+    if (p[5] != 1) throw fail("not a little-endian ELF file");
+    if (elf16(p + 18) != 243) throw fail("not a RISC-V ELF file");
+    if (elf16(p + 16) != 2) throw fail("not an executable (link it statically first)");
+
+    ElfImage image;
+    image.entry = elf32(p + 24);
+    uint32_t shoff = elf32(p + 32);
+    uint16_t shentsize = elf16(p + 46), shnum = elf16(p + 48);
+    if (shoff == 0 || shentsize < 40 || uint64_t(shoff) + uint64_t(shnum) * shentsize > size) {
+        throw fail("missing or truncated section headers");
+    }
+
+    struct Section { uint32_t name, type, flags, addr, offset, size, link; };
+    vector<Section> sections(shnum);
+    for (uint16_t i = 0; i < shnum; i++) {
+        const uint8_t* h = p + shoff + size_t(i) * shentsize;
+        sections[i] = {elf32(h), elf32(h + 4), elf32(h + 8), elf32(h + 12), elf32(h + 16), elf32(h + 20), elf32(h + 24)};
+    }
+    auto contents = [&](const Section& s) {
+        if (s.type == 8 /* SHT_NOBITS */) return (const uint8_t*)nullptr;
+        if (uint64_t(s.offset) + s.size > size) throw fail("section extends past the end of the file");
+        return p + s.offset;
+    };
+    const uint32_t SHF_ALLOC = 0x2, SHF_EXECINSTR = 0x4;
+
+    // Executable sections become one contiguous instruction memory
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (const Section& s : sections) {
+        if ((s.flags & SHF_ALLOC) && (s.flags & SHF_EXECINSTR) && s.size) {
+            lo = min(lo, s.addr);
+            hi = max(hi, s.addr + s.size);
+        }
+    }
+    if (lo >= hi) throw fail("no executable sections");
+    if (lo % 4) throw fail("text is not word aligned");
+    image.textBase = lo;
+    image.text.assign((hi - lo + 3) / 4, 0);
+    for (const Section& s : sections) {
+        if (!(s.flags & SHF_ALLOC) || !s.size) continue;
+        const uint8_t* bytes = contents(s);
+        if (s.flags & SHF_EXECINSTR) {
+            if (!bytes) continue;
+            for (uint32_t i = 0; i + 3 < s.size; i += 4) image.text[(s.addr - lo + i) / 4] = elf32(bytes + i);
+        } else {
+            DataSegment segment;
+            segment.addr = s.addr;
+            segment.size = s.size;
+            if (bytes) segment.bytes.assign(bytes, bytes + s.size);
+            image.data.push_back(move(segment));
+        }
+    }
+
+    // Symbol names for reporting, from .symtab and its string table
+    for (const Section& s : sections) {
+        if (s.type != 2 /* SHT_SYMTAB */ || s.link >= sections.size()) continue;
+        const uint8_t* syms = contents(s);
+        const Section& strtab = sections[s.link];
+        const uint8_t* strs = contents(strtab);
+        if (!syms || !strs) continue;
+        for (uint32_t off = 16; off + 16 <= s.size; off += 16) {
+            const uint8_t* sym = syms + off;
+            uint32_t name = elf32(sym), value = elf32(sym + 4);
+            uint8_t type = sym[12] & 0xF;
+            if (name == 0 || name >= strtab.size || (type != 0 /* NOTYPE */ && type != 2 /* FUNC */)) continue;
+            if (value < lo || value >= hi || elf16(sym + 14) == 0 /* undefined */) continue;
+            const char* text = reinterpret_cast<const char*>(strs + name);
+            string label(text, strnlen(text, strtab.size - name));
+            // Skip assembler-local and mapping symbols such as .L0 or $x
+            if (label.empty() || label[0] == '.' || label[0] == '$') continue;
+            image.symbols.emplace(value, label);
+        }
+    }
+    return image;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "pipeline.hpp"
+
+// Forwarding core: results are forwarded from EX/MEM and MEM/WB, so the
+// only data hazard that still needs a stall is a load followed by a use.
+// Branches resolved in ID compare their operands a stage earlier and also
+// wait for an ALU result still in EX or a load still in MEM.
+struct ForwardingPolicy {
+    static constexpr const char* name = "forward";
+    static constexpr bool forwards = true;
+
+    // Cycles after issue until a result can be forwarded: an ALU result
+    // from EX/MEM, loaded data from MEM/WB
+    static int readyAfter(const ControlSignals& ctrl) { return ctrl.memRead ? 3 : 2; }
+
+    // Check for stalls (only load-use hazards); waits is set to the
+    // registers not ready yet
+    static StallCause check_stall(const Scoreboard& scoreboard, uint64_t now, const PipelineRegisters& pipeRegs, const DecodedInstr& d,
+                                  const PipelineConfig& config, bool& is_nop, uint32_t& waits) {
+        (void)pipeRegs;
+        (void)is_nop;
+        uint32_t sources = Scoreboard::sources(d);
+
+        // EX takes the operands next cycle; only a load can be that late
+        if ((waits = scoreboard.blocked(sources, now + 1))) {
+            return STALL_LOAD_USE;
+        }
+
+        // Branch operands are needed in ID, before EX can forward them
+        if (config.branchStage == STAGE_ID && (d.opcode == 0x63 || d.opcode == 0x67) && (waits = scoreboard.blocked(sources, now))) {
+            return STALL_BRANCH_OPERAND;
+        }
+        return STALL_NONE;
+    }
+};
+
+using ForwardingProcessor = Processor<ForwardingPolicy>;
@@ -0,0 +1,229 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "isa.hpp"
+#include "program.hpp"
+
+using namespace std;
+
+// Functional-only simulator, with no pipeline registers or timing. Used to
+// fast-forward to a region of interest and hand the state to a Processor.
+//
+// run() and runTo() translate each basic block the first time it executes
+// into an array of ops, each holding the address of its handler and its
+// decoded operands, and then execute blocks by direct threading: every
+// handler ends by jumping straight to the next op's handler. Instruction
+// memory is separate from data memory and stores never reach it, so a
+// translation stays valid for the whole run. step() executes one
+// instruction from the predecoded table; it finishes a run that stops
+// inside a block, and is the reference the translations follow.
+class FunctionalSim {
+    // What an op does, one handler per instruction and the block exit
+    enum Handler : uint8_t {
+        H_ADD, H_SUB, H_SLL, H_SLT, H_SLTU, H_XOR, H_SRL, H_SRA, H_OR, H_AND,
+        H_ADDI, H_SLLI, H_SLTI, H_SLTIU, H_XORI, H_SRLI, H_SRAI, H_ORI, H_ANDI,
+        H_LB, H_LH, H_LW, H_LBU, H_LHU, H_SB, H_SH, H_SW,
+        H_SET, // lui and auipc: rd gets a constant
+        H_NOP, // Anything else that decodes without effect, e.g. fence or ecall
+        H_BEQ, H_BNE, H_BLT, H_BGE, H_BLTU, H_BGEU, H_JAL, H_JALR,
+        H_EXIT, // Leave the block at target: it ran into a block boundary
+        NUM_HANDLERS
+    };
+
+    struct Op {
+        const void* handler = nullptr; // Label in runBlocks()
+        uint8_t rd = 0, rs1 = 0, rs2 = 0; // rd 0 is written to a scratch register instead
+        uint32_t imm = 0;    // Immediate, shift amount or constant
+        uint32_t target = 0; // Taken target of a branch or jal, or where an exit goes
+        uint32_t after = 0;  // pc + 4: the link of jumps, the fall-through of branches
+    };
+
+    struct Block {
+        uint32_t length = 0; // Instructions, the branch or jump ending it included
+        vector<Op> ops;
+    };
+
+    const Program& program;
+    ArchState state;
+    uint64_t executed = 0;
+    vector<int32_t> blockAt; // Block starting at each instruction, -1 until translated
+    vector<Block> blocks;
+
+    // Translate the block starting at pc, binding every op to its handler
+    const Block& translate(uint32_t pc, const void* const* handlers) {
+        static const Handler rType[8] = {H_ADD, H_SLL, H_SLT, H_SLTU, H_XOR, H_SRL, H_OR, H_AND};
+        static const Handler iType[8] = {H_ADDI, H_SLLI, H_SLTI, H_SLTIU, H_XORI, H_SRLI, H_ORI, H_ANDI};
+        static const Handler loads[8] = {H_LB, H_LH, H_LW, H_LW, H_LBU, H_LHU, H_LW, H_LW};
+        static const Handler stores[8] = {H_SB, H_SH, H_SW, H_SW, H_SW, H_SW, H_SW, H_SW};
+        static const Handler branches[8] = {H_BEQ, H_BNE, H_EXIT, H_EXIT, H_BLT, H_BGE, H_BLTU, H_BGEU};
+
+        Block block;
+        for (uint32_t at = pc;; at += 4) {
+            const DecodedInstr& d = program.decoded[program.index(at)];
+            Op op;
+            Handler h = H_NOP;
+            op.rd = d.rd ? d.rd : 32;
+            op.rs1 = d.rs1;
+            op.rs2 = d.rs2;
+            op.imm = uint32_t(d.imm);
+            op.target = at + uint32_t(d.imm);
+            op.after = at + 4;
+            // The same cases as aluResult(), loadData() and storeData()
+            switch (d.opcode) {
+                case 0x33:
+                    h = rType[d.funct3];
+                    if (d.funct7 == 0x20 && d.funct3 == 0x0) h = H_SUB;
+                    if (d.funct7 == 0x20 && d.funct3 == 0x5) h = H_SRA;
+                    break;
+                case 0x13:
+                    h = iType[d.funct3];
+                    if ((d.funct7 & 0x20) && d.funct3 == 0x5) h = H_SRAI;
+                    if (d.funct3 == 0x1 || d.funct3 == 0x5) op.imm &= 0x1F;
+                    break;
+                case 0x03: h = loads[d.funct3]; break;
+                case 0x23: h = stores[d.funct3]; break;
+                case 0x37: h = H_SET; break;
+                case 0x17: h = H_SET; op.imm = at + uint32_t(d.imm); break;
+                case 0x63:
+                    h = branches[d.funct3];
+                    if (h == H_EXIT) op.target = at + 4; // Never taken
+                    break;
+                case 0x6F: h = H_JAL; break;
+                case 0x67: h = H_JALR; break;
+            }
+            op.handler = handlers[h];
+            block.ops.push_back(op);
+            block.length++;
+            if (d.ctrl.branch) break;
+            if (!program.contains(at + 4)) {
+                Op exit;
+                exit.handler = handlers[H_EXIT];
+                exit.target = at + 4;
+                block.ops.push_back(exit);
+                break;
+            }
+        }
+        blockAt[program.index(pc)] = int32_t(blocks.size());
+        blocks.push_back(move(block));
+        return blocks.back();
+    }
+
+    // Execute whole blocks while the next one fits in limit and, with stop,
+    // does not run past target; returns the instructions executed. A block
+    // entered at a misaligned pc is left to step().
+    uint64_t runBlocks(uint64_t limit, bool stop, uint32_t target) {
+        static const void* const handlers[NUM_HANDLERS] = {
+            &&add, &&sub, &&sll, &&slt, &&sltu, &&xor_, &&srl, &&sra, &&or_, &&and_,
+            &&addi, &&slli, &&slti, &&sltiu, &&xori, &&srli, &&srai, &&ori, &&andi,
+            &&lb, &&lh, &&lw, &&lbu, &&lhu, &&sb, &&sh, &&sw,
+            &&set, &&nop, &&beq, &&bne, &&blt, &&bge, &&bltu, &&bgeu, &&jal, &&jalr, &&exit};
+        if (blockAt.empty()) blockAt.assign(program.instrMemory.size(), -1);
+
+        uint32_t x[33]; // x[32] takes the writes to x0
+        copy(state.registers.begin(), state.registers.end(), x);
+        PagedMemory& mem = state.dataMemory;
+        uint32_t pc = state.pc;
+        uint64_t left = limit;
+        const Op* op;
+
+#define NEXT goto *(++op)->handler
+        while (program.contains(pc) && !(stop && pc == target) && (pc - program.base) % 4 == 0) {
+            {
+                int32_t b = blockAt[program.index(pc)];
+                const Block& block = b < 0 ? translate(pc, handlers) : blocks[b];
+                if (block.length > left || (stop && target - pc < block.length * 4)) break;
+                left -= block.length;
+                op = block.ops.data();
+            }
+            goto *op->handler;
+
+        add:   x[op->rd] = x[op->rs1] + x[op->rs2]; NEXT;
+        sub:   x[op->rd] = x[op->rs1] - x[op->rs2]; NEXT;
+        sll:   x[op->rd] = x[op->rs1] << (x[op->rs2] & 0x1F); NEXT;
+        slt:   x[op->rd] = int32_t(x[op->rs1]) < int32_t(x[op->rs2]); NEXT;
+        sltu:  x[op->rd] = x[op->rs1] < x[op->rs2]; NEXT;
+        xor_:  x[op->rd] = x[op->rs1] ^ x[op->rs2]; NEXT;
+        srl:   x[op->rd] = x[op->rs1] >> (x[op->rs2] & 0x1F); NEXT;
+        sra:   x[op->rd] = uint32_t(int32_t(x[op->rs1]) >> (x[op->rs2] & 0x1F)); NEXT;
+        or_:   x[op->rd] = x[op->rs1] | x[op->rs2]; NEXT;
+        and_:  x[op->rd] = x[op->rs1] & x[op->rs2]; NEXT;
+        addi:  x[op->rd] = x[op->rs1] + op->imm; NEXT;
+        slli:  x[op->rd] = x[op->rs1] << op->imm; NEXT;
+        slti:  x[op->rd] = int32_t(x[op->rs1]) < int32_t(op->imm); NEXT;
+        sltiu: x[op->rd] = x[op->rs1] < op->imm; NEXT;
+        xori:  x[op->rd] = x[op->rs1] ^ op->imm; NEXT;
+        srli:  x[op->rd] = x[op->rs1] >> op->imm; NEXT;
+        srai:  x[op->rd] = uint32_t(int32_t(x[op->rs1]) >> op->imm); NEXT;
+        ori:   x[op->rd] = x[op->rs1] | op->imm; NEXT;
+        andi:  x[op->rd] = x[op->rs1] & op->imm; NEXT;
+        lb:    x[op->rd] = uint32_t(int8_t(mem.load8(x[op->rs1] + op->imm))); NEXT;
+        lh:    x[op->rd] = uint32_t(int16_t(mem.load16(x[op->rs1] + op->imm))); NEXT;
+        lw:    x[op->rd] = mem.load32(x[op->rs1] + op->imm); NEXT;
+        lbu:   x[op->rd] = mem.load8(x[op->rs1] + op->imm); NEXT;
+        lhu:   x[op->rd] = mem.load16(x[op->rs1] + op->imm); NEXT;
+        sb:    mem.store8(x[op->rs1] + op->imm, uint8_t(x[op->rs2])); NEXT;
+        sh:    mem.store16(x[op->rs1] + op->imm, uint16_t(x[op->rs2])); NEXT;
+        sw:    mem.store32(x[op->rs1] + op->imm, x[op->rs2]); NEXT;
+        set:   x[op->rd] = op->imm; NEXT;
+        nop:   NEXT;
+        beq:   pc = x[op->rs1] == x[op->rs2] ? op->target : op->after; continue;
+        bne:   pc = x[op->rs1] != x[op->rs2] ? op->target : op->after; continue;
+        blt:   pc = int32_t(x[op->rs1]) < int32_t(x[op->rs2]) ? op->target : op->after; continue;
+        bge:   pc = int32_t(x[op->rs1]) >= int32_t(x[op->rs2]) ? op->target : op->after; continue;
+        bltu:  pc = x[op->rs1] < x[op->rs2] ? op->target : op->after; continue;
+        bgeu:  pc = x[op->rs1] >= x[op->rs2] ? op->target : op->after; continue;
+        jal:   x[op->rd] = op->after; pc = op->target; continue;
+        jalr:  pc = (x[op->rs1] + op->imm) & ~1u; x[op->rd] = op->after; continue;
+        exit:  pc = op->target; continue;
+        }
+#undef NEXT
+
+        copy(x, x + 32, state.registers.begin());
+        state.pc = pc;
+        executed += limit - left;
+        return limit - left;
+    }
+
+public:
+    FunctionalSim(const Program& program) : program(program), state(initialState(program)) {}
+    FunctionalSim(const Program& program, const ArchState& state) : program(program), state(state) {}
+
+    bool done() const { return !program.contains(state.pc); }
+
+    // Execute the instruction at pc
+    void step() {
+        const DecodedInstr& d = program.decoded[program.index(state.pc)];
+        vector<uint32_t>& regs = state.registers;
+        uint32_t a = regs[d.rs1], b = regs[d.rs2];
+        uint32_t next = state.pc + 4;
+        uint32_t value = aluResult(d, state.pc, a, b);
+        switch (d.opcode) {
+            case 0x03: value = loadData(state.dataMemory, value, d.funct3); break;
+            case 0x23: storeData(state.dataMemory, value, b, d.funct3); break;
+            case 0x63: if (branchTaken(d, a, b)) next = branchTarget(d, state.pc, a); break;
+            case 0x67:
+            case 0x6F: next = branchTarget(d, state.pc, a); break;
+        }
+        if (d.ctrl.regWrite && d.rd != 0) regs[d.rd] = value;
+        state.pc = next;
+        executed++;
+    }
+
+    // Run up to count instructions; returns how many were executed
+    uint64_t run(uint64_t count) {
+        uint64_t start = executed;
+        runBlocks(count, false, 0);
+        while (executed - start < count && !done()) step();
+        return executed - start;
+    }
+
+    // Run until pc reaches target (or the program ends, or limit runs out)
+    uint64_t runTo(uint32_t target, uint64_t limit = UINT64_MAX) {
+        uint64_t start = executed;
+        runBlocks(limit, true, target);
+        while (state.pc != target && executed - start < limit && !done()) step();
+        return executed - start;
+    }
+
+    uint64_t instructions() const { return executed; }
+    const ArchState& archState() const { return state; }
+};
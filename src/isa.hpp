@@ -0,0 +1,373 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "memory.hpp"
+
+using namespace std;
+
+// Struct for control signals
+struct ControlSignals {
+    bool regWrite = false;
+    bool memRead = false;
+    bool memWrite = false;
+    uint8_t aluSrc = 0; // 0: use register value, 1: use immediate value
+    uint8_t aluOp = 0; // 0: add, 1: beq
+    uint8_t memToReg = 0; // 0: use ALU result, 1: use memory read value
+    uint8_t branch = 0; // 0: no branch, 1: branch
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& c) {
+        ar.field(c.regWrite); ar.field(c.memRead); ar.field(c.memWrite);
+        ar.field(c.aluSrc); ar.field(c.aluOp); ar.field(c.memToReg); ar.field(c.branch);
+    }
+};
+
+inline void setControlSignals(uint32_t instr, ControlSignals& ctrl, uint32_t& opcode) {
+    opcode = instr & 0x7F;
+    switch (opcode) {
+        case 0x33: // R-type
+            ctrl.regWrite = true;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 0;
+            ctrl.aluOp = 1;
+            ctrl.memToReg = 0;
+            ctrl.branch = 0;
+            break;
+        case 0x03: // Load
+            ctrl.regWrite = true;
+            ctrl.memRead = true;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 1;
+            ctrl.branch = 0;
+            break;
+        case 0x13: // Immediate
+            ctrl.regWrite = true;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 0;
+            break;
+        case 0x23: // Store
+            ctrl.regWrite = false;
+            ctrl.memRead = false;
+            ctrl.memWrite = true;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 0;
+            break;
+        case 0x63: // Branch
+            ctrl.regWrite = false;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 0;
+            ctrl.aluOp = 1;
+            ctrl.memToReg = 0;
+            ctrl.branch = 1;
+            break;
+        case 0x37: // lui
+            ctrl.regWrite = true;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 0;
+            break;
+        case 0x67: // jalr
+            ctrl.regWrite = true;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 1;
+            break;
+        case 0x6F: // jal
+            ctrl.regWrite = true;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 1;
+            break;
+        case 0x17: // auipc
+            ctrl.regWrite = true;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 1;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 0;
+            break;
+        default:
+            ctrl.regWrite = false;
+            ctrl.memRead = false;
+            ctrl.memWrite = false;
+            ctrl.aluSrc = 0;
+            ctrl.aluOp = 0;
+            ctrl.memToReg = 0;
+            ctrl.branch = 0;
+            break;
+    }
+}
+
+inline int32_t generateImmediate(uint32_t instr) {
+    int32_t imm;
+    switch (instr & 0x7F) {
+        case 0x13: // I-type: addi
+        case 0x03: // I-type: lb
+        case 0x67: // I-type: jalr
+            // Extract bits 31:20 and sign-extend to 32 bits
+            imm = static_cast<int32_t>(instr) >> 20;
+            break;
+
+        case 0x23: // S-type: sw
+            // Extract bits 31:25 and 11:7, combine, and sign-extend
+            imm = ((instr >> 25) << 5) |             // imm[11:5]
+                  ((instr >> 7) & 0x1F);             // imm[4:0]
+            imm = static_cast<int32_t>(imm << 20) >> 20; // Sign-extend from bit 11
+            break;
+
+        case 0x63: // B-type: beq
+            // Extract and rearrange bits for B-type immediate
+            imm = ((instr >> 31) << 11) |            // imm[12]
+                  (((instr >> 7) & 0x1) << 10) |     // imm[11]
+                  (((instr >> 25) & 0x3F) << 4) |    // imm[10:5]
+                  (((instr >> 8) & 0xF) << 0);       // imm[4:1]
+            imm <<= 1; // Bit 0 is 0
+            imm = (imm << 19) >> 19; // Sign-extend from bit 12
+            break;
+
+        case 0x6F: // J-type: jal
+            // Extract and rearrange bits for J-type immediate
+            imm = ((instr >> 31) << 19) |            // imm[20]
+                  (((instr >> 12) & 0xFF) << 11) |   // imm[19:12]
+                  (((instr >> 20) & 0x1) << 10) |    // imm[11]
+                  (((instr >> 21) & 0x3FF) << 0);    // imm[10:1]
+            imm <<= 1; // Bit 0 is 0
+            imm = (imm << 11) >> 11; // Sign-extend from bit 20
+            break;
+
+        case 0x37: // U-type: lui
+        case 0x17: // U-type: auipc
+            imm = static_cast<int32_t>(instr & 0xFFFFF000);
+            break;
+
+        default:
+            imm = 0; // Default case for unsupported opcodes
+            break;
+    }
+    return imm;
+}
+
+// Everything the pipeline needs to know about one instruction, extracted
+// once when the program is loaded so stages never touch the raw word
+struct DecodedInstr {
+    ControlSignals ctrl;
+    uint8_t opcode = 0;
+    uint8_t rd = 0, rs1 = 0, rs2 = 0;
+    uint8_t funct3 = 0, funct7 = 0;
+    bool uses_rs1 = false; // not lui, auipc, jal
+    bool uses_rs2 = false; // R-type, branch, store
+    int32_t imm = 0;
+};
+
+inline DecodedInstr predecode(uint32_t instr) {
+    DecodedInstr d;
+    uint32_t opcode;
+    setControlSignals(instr, d.ctrl, opcode);
+    d.opcode = opcode;
+    d.rd = (instr >> 7) & 0x1F;
+    d.rs1 = (instr >> 15) & 0x1F;
+    d.rs2 = (instr >> 20) & 0x1F;
+    d.funct3 = (instr >> 12) & 0x7;
+    d.funct7 = (instr >> 25) & 0x7F;
+    d.uses_rs1 = (opcode != 0x37 && opcode != 0x17 && opcode != 0x6F);
+    d.uses_rs2 = (opcode == 0x33 || opcode == 0x63 || opcode == 0x23);
+    d.imm = generateImmediate(instr);
+    return d;
+}
+
+inline vector<DecodedInstr> predecodeProgram(const vector<uint32_t>& instrMemory) {
+    vector<DecodedInstr> decoded;
+    decoded.reserve(instrMemory.size());
+    for (uint32_t instr : instrMemory) {
+        decoded.push_back(predecode(instr));
+    }
+    return decoded;
+}
+
+// ALU result of an instruction: the computed value for arithmetic, the
+// address for loads and stores, and the link address for jumps
+inline uint32_t aluResult(const DecodedInstr& d, uint32_t pc, uint32_t a, uint32_t b) {
+    uint32_t imm = static_cast<uint32_t>(d.imm);
+    switch (d.opcode) {
+        case 0x33: // R-type
+            switch (d.funct3) {
+                case 0x0: return (d.funct7 == 0x20) ? a - b : a + b;
+                case 0x1: return a << (b & 0x1F);
+                case 0x2: return static_cast<int32_t>(a) < static_cast<int32_t>(b);
+                case 0x3: return a < b;
+                case 0x4: return a ^ b;
+                case 0x5: return (d.funct7 == 0x20) ? static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 0x1F)) : a >> (b & 0x1F);
+                case 0x6: return a | b;
+                default: return a & b;
+            }
+        case 0x13: // I-type arithmetic
+            switch (d.funct3) {
+                case 0x0: return a + imm;
+                case 0x1: return a << (imm & 0x1F);
+                case 0x2: return static_cast<int32_t>(a) < d.imm;
+                case 0x3: return a < imm;
+                case 0x4: return a ^ imm;
+                case 0x5: return (d.funct7 & 0x20) ? static_cast<uint32_t>(static_cast<int32_t>(a) >> (imm & 0x1F)) : a >> (imm & 0x1F);
+                case 0x6: return a | imm;
+                default: return a & imm;
+            }
+        case 0x03: // Load address
+        case 0x23: // Store address
+            return a + imm;
+        case 0x37: // lui
+            return imm;
+        case 0x17: // auipc
+            return pc + imm;
+        case 0x67: // jalr
+        case 0x6F: // jal
+            return pc + 4;
+        default:
+            return 0;
+    }
+}
+
+// Outcome of a conditional branch (beq, bne, blt, bge, bltu, bgeu)
+inline bool branchTaken(const DecodedInstr& d, uint32_t a, uint32_t b) {
+    switch (d.funct3) {
+        case 0x0: return a == b;
+        case 0x1: return a != b;
+        case 0x4: return static_cast<int32_t>(a) < static_cast<int32_t>(b);
+        case 0x5: return static_cast<int32_t>(a) >= static_cast<int32_t>(b);
+        case 0x6: return a < b;
+        case 0x7: return a >= b;
+        default: return false;
+    }
+}
+
+// Where a jump or branch goes if it is taken
+inline uint32_t branchTarget(const DecodedInstr& d, uint32_t pc, uint32_t a) {
+    if (d.opcode == 0x67) return (a + static_cast<uint32_t>(d.imm)) & ~1u;
+    return pc + static_cast<uint32_t>(d.imm);
+}
+
+// Loads and stores as funct3 selects them, on the sparse data memory
+inline uint32_t loadData(const PagedMemory& mem, uint32_t addr, uint8_t funct3) {
+    switch (funct3) {
+        case 0x0: return static_cast<uint32_t>(static_cast<int8_t>(mem.load8(addr)));   // lb
+        case 0x1: return static_cast<uint32_t>(static_cast<int16_t>(mem.load16(addr))); // lh
+        case 0x4: return mem.load8(addr);                                                // lbu
+        case 0x5: return mem.load16(addr);                                               // lhu
+        default: return mem.load32(addr);                                                // lw
+    }
+}
+
+inline void storeData(PagedMemory& mem, uint32_t addr, uint32_t value, uint8_t funct3) {
+    switch (funct3) {
+        case 0x0: mem.store8(addr, uint8_t(value)); break;   // sb
+        case 0x1: mem.store16(addr, uint16_t(value)); break; // sh
+        default: mem.store32(addr, value); break;            // sw
+    }
+}
+
+// Longest text disassembleTo() writes: ".word 0x" or four short fields
+static const size_t maxDisassemblyLength = 48;
+
+// Text for an instruction word, in the operand order of the input listings
+// ("addi x5 x0 1", "lw x7 0 x7", "sw x1 0 x2", "beq x6 x0 12"), written to
+// out without allocating. Returns the end of the text.
+inline char* disassembleTo(char* out, uint32_t instr, const DecodedInstr& d) {
+    static const char* const rType[8] = {"add", "sll", "slt", "sltu", "xor", "srl", "or", "and"};
+    static const char* const iType[8] = {"addi", "slli", "slti", "sltiu", "xori", "srli", "ori", "andi"};
+    static const char* const loads[8] = {"lb", "lh", "lw", nullptr, "lbu", "lhu", nullptr, nullptr};
+    static const char* const stores[8] = {"sb", "sh", "sw", nullptr, nullptr, nullptr, nullptr, nullptr};
+    static const char* const branches[8] = {"beq", "bne", nullptr, nullptr, "blt", "bge", "bltu", "bgeu"};
+
+    char* p = out;
+    auto text = [&](const char* s) { while (*s) *p++ = *s++; };
+    auto num = [&](int64_t v, int base = 10) { p = to_chars(p, p + 12, v, base).ptr; };
+    auto reg = [&](unsigned r) { *p++ = ' '; *p++ = 'x'; num(r); };
+    auto imm = [&](int64_t v) { *p++ = ' '; num(v); };
+    auto upper = [&]() { text(" 0x"); num(uint32_t(d.imm) >> 12, 16); };
+
+    switch (d.opcode) {
+        case 0x33:
+            if (d.funct7 == 0x01) break; // M extension is not modelled
+            text(d.funct7 == 0x20 && d.funct3 == 0x0 ? "sub" : d.funct7 == 0x20 && d.funct3 == 0x5 ? "sra" : rType[d.funct3]);
+            reg(d.rd); reg(d.rs1); reg(d.rs2);
+            return p;
+        case 0x13:
+            text(d.funct3 == 0x5 && (d.funct7 & 0x20) ? "srai" : iType[d.funct3]);
+            reg(d.rd); reg(d.rs1); imm((d.funct3 & 3) == 1 ? d.imm & 0x1F : d.imm);
+            return p;
+        case 0x03:
+            if (!loads[d.funct3]) break;
+            text(loads[d.funct3]); reg(d.rd); imm(d.imm); reg(d.rs1);
+            return p;
+        case 0x23:
+            if (!stores[d.funct3]) break;
+            text(stores[d.funct3]); reg(d.rs2); imm(d.imm); reg(d.rs1);
+            return p;
+        case 0x63:
+            if (!branches[d.funct3]) break;
+            text(branches[d.funct3]); reg(d.rs1); reg(d.rs2); imm(d.imm);
+            return p;
+        case 0x37: text("lui"); reg(d.rd); upper(); return p;
+        case 0x17: text("auipc"); reg(d.rd); upper(); return p;
+        case 0x6F: text("jal"); reg(d.rd); imm(d.imm); return p;
+        case 0x67: text("jalr"); reg(d.rd); reg(d.rs1); imm(d.imm); return p;
+        case 0x73:
+            if (instr == 0x00000073) { text("ecall"); return p; }
+            if (instr == 0x00100073) { text("ebreak"); return p; }
+            break;
+        case 0x0F: text("fence"); return p;
+    }
+    text(".word 0x");
+    char* digits = p;
+    num(instr, 16);
+    size_t n = p - digits;
+    memmove(digits + (8 - n), digits, n); // Zero-pad to eight digits
+    memset(digits, '0', 8 - n);
+    p = digits + 8;
+    return p;
+}
+
+inline string disassemble(uint32_t instr) {
+    char buf[maxDisassemblyLength];
+    return string(buf, disassembleTo(buf, instr, predecode(instr)));
+}
+
+// Instruction encoders, for the programs the differential check generates
+inline uint32_t encodeR(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd) {
+    return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | 0x33;
+}
+inline uint32_t encodeI(int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    return (uint32_t(imm) & 0xFFF) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+inline uint32_t encodeS(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3) {
+    uint32_t u = uint32_t(imm) & 0xFFF;
+    return (u >> 5) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | (u & 0x1F) << 7 | 0x23;
+}
+inline uint32_t encodeB(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3) {
+    uint32_t u = uint32_t(imm) & 0x1FFF;
+    return (u >> 12 & 1) << 31 | (u >> 5 & 0x3F) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | (u >> 1 & 0xF) << 8 |
+           (u >> 11 & 1) << 7 | 0x63;
+}
+inline uint32_t encodeJ(int32_t imm, uint32_t rd) {
+    uint32_t u = uint32_t(imm) & 0x1FFFFF;
+    return (u >> 20 & 1) << 31 | (u >> 1 & 0x3FF) << 21 | (u >> 11 & 1) << 20 | (u >> 12 & 0xFF) << 12 | rd << 7 | 0x6F;
+}
+inline uint32_t encodeU(uint32_t upper, uint32_t rd, uint32_t opcode) { return upper << 12 | rd << 7 | opcode; }
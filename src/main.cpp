@@ -0,0 +1,377 @@
+#include <bits/stdc++.h>
+#include "runner.hpp"
+#include "batch.hpp"
+#include "sweep.hpp"
+#include "counters.hpp"
+
+using namespace std;
+
+// Parse a cycle count: digits only, so signs, trailing text and values past
+// 64 bits are rejected instead of throwing or wrapping
+static bool parseCount(const string& text, uint64_t& value) {
+    if (text.empty() || text.size() > 19 || text.find_first_not_of("0123456789") != string::npos) return false;
+    value = stoull(text);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> args;
+    TraceLevel level = TraceLevel::Stage;
+    vector<ModeEntry> modes;
+    parseModeList("both", modes);
+    string batchSource, sweepSource;
+    // Timing parameters; a sweep reads each as a list or range of values
+    string forwardingArg, branchStageArg, loadLatencyArg, branchPenaltyArg;
+    string l1iArg, l1dArg, predictorArg, widthArg, portsArg, pipelineArg, windowArg;
+    string skipArg, skipToArg;
+    string checkpointPath, checkpointAtArg, checkpointEveryArg, restorePath;
+    size_t jobs = 0;
+    string outPath;
+    string countersPath;
+    string profilePath;
+    uint64_t profileTop = RunOptions().profileTop;
+    string outDir = "../outputfiles";
+    string format = "text";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        // Options take their value either as --name=value or as the next argument
+        auto option = [&](const string& name, string& value) {
+            if (arg.rfind(name + "=", 0) == 0) { value = arg.substr(name.size() + 1); return true; }
+            if (arg == name && i + 1 < argc) { value = argv[++i]; return true; }
+            return false;
+        };
+        string value;
+        if (option("--trace", value)) {
+            if (!parseTraceLevel(value, level)) {
+                cerr << "Unknown trace level: " << value << " (expected off, summary, cycle or stage)" << endl;
+                return 1;
+            }
+        } else if (option("--mode", value)) {
+            if (!parseModeList(value, modes)) {
+                cerr << "Unknown mode: " << value << " (expected forward, noforward, ooo, both, all or a comma-separated list)" << endl;
+                return 1;
+            }
+        } else if (option("--batch", value)) {
+            batchSource = value;
+        } else if (option("--sweep", value)) {
+            sweepSource = value;
+        } else if (option("--forwarding", value)) {
+            forwardingArg = value;
+        } else if (option("--branch-stage", value)) {
+            branchStageArg = value;
+        } else if (option("--load-latency", value)) {
+            loadLatencyArg = value;
+        } else if (option("--branch-penalty", value)) {
+            branchPenaltyArg = value;
+        } else if (option("--l1i", value)) {
+            l1iArg = value;
+        } else if (option("--l1d", value)) {
+            l1dArg = value;
+        } else if (option("--predictor", value)) {
+            predictorArg = value;
+        } else if (option("--width", value)) {
+            widthArg = value;
+        } else if (option("--ports", value)) {
+            portsArg = value;
+        } else if (option("--pipeline", value)) {
+            pipelineArg = value;
+        } else if (option("--window", value)) {
+            windowArg = value;
+        } else if (option("--skip", value)) {
+            skipArg = value;
+        } else if (option("--skip-to", value)) {
+            skipToArg = value;
+        } else if (option("--checkpoint", value)) {
+            checkpointPath = value;
+        } else if (option("--checkpoint-at", value)) {
+            checkpointAtArg = value;
+        } else if (option("--checkpoint-every", value)) {
+            checkpointEveryArg = value;
+        } else if (option("--restore", value)) {
+            restorePath = value;
+        } else if (option("--jobs", value) || option("-j", value)) {
+            uint64_t count;
+            if (!parseCount(value, count) || count == 0 || count > 4096) {
+                cerr << "Bad job count: " << value << " (expected a whole number from 1 to 4096)" << endl;
+                return 1;
+            }
+            jobs = count;
+        } else if (option("--out", value) || option("-o", value)) {
+            outPath = value;
+        } else if (option("--profile", value)) {
+            profilePath = value;
+        } else if (option("--profile-top", value)) {
+            if (!parseCount(value, profileTop) || profileTop == 0) {
+                cerr << "Bad profile row count: " << value << " (expected a whole number from 1)" << endl;
+                return 1;
+            }
+        } else if (option("--counters", value)) {
+            countersPath = value;
+        } else if (option("--out-dir", value)) {
+            outDir = value;
+        } else if (option("--format", value)) {
+            if (value != "text" && value != "binary") {
+                cerr << "Unknown output format: " << value << " (expected text or binary)" << endl;
+                return 1;
+            }
+            format = value;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    bool many = !batchSource.empty() || !sweepSource.empty();
+    if (args.size() != (many ? 1u : 2u) || (!batchSource.empty() && !sweepSource.empty())) {
+        cerr << "Usage: " << argv[0] << " <input_file> <cycles> [--mode forward|noforward|ooo|both|all]"
+             << " [--trace off|summary|cycle|stage] [--format text|binary] [--out <file>] [--out-dir <dir>]"
+             << " [--skip N | --skip-to <pc>] [--checkpoint <file> --checkpoint-at C | --checkpoint-every N]"
+             << " [--restore <file>] [--counters <file.json|file.csv>] [--profile <prefix> [--profile-top N]]\n"
+             << "       " << argv[0] << " --batch <manifest|dir> <cycles> [--mode forward,noforward,ooo] [--jobs N]"
+             << " [--format text|binary] [--out-dir <dir>]\n"
+             << "       " << argv[0] << " --sweep <manifest|dir> <cycles> [--forwarding on,off] [--branch-stage id,ex]"
+             << " [--load-latency 1-3] [--branch-penalty 0,1] [--jobs N] [--out-dir <dir>]\n"
+             << "Single runs and batches also take one --branch-stage, --load-latency and --branch-penalty value.\n"
+             << "All three take --l1i and --l1d caches, e.g. --l1d size=8k,ways=4,line=32,repl=lru|fifo|random,"
+             << "write=back|through,penalty=10, and a --predictor, e.g. --predictor gshare,btb=512,bits=12,history=12"
+             << " (none, nottaken, btfn, bimodal, gshare or tage), an issue --width 1-8 with --ports mem=M,branch=B"
+             << " and a --pipeline of 5, 7 or 8 stages or a list such as IF1,IF2,ID,RR,EX,MEM1,MEM2,WB."
+             << " The ooo core takes a --window, e.g. --window rob=64,iq=16,lsq=16,prf=96" << endl;
+        return 1;
+    }
+
+    CacheConfig l1i, l1d;
+    for (auto [arg, cache] : {pair{&l1iArg, &l1i}, pair{&l1dArg, &l1d}}) {
+        if (!arg->empty() && !parseCacheSpec(*arg, *cache)) {
+            cerr << "Bad cache: " << *arg << " (expected size=<bytes>[k],ways=N,line=<bytes>,repl=lru|fifo|random,"
+                 << "write=back|through,penalty=N with power-of-two sizes)" << endl;
+            return 1;
+        }
+    }
+
+    PredictorConfig predictor;
+    if (!predictorArg.empty() && !parsePredictorSpec(predictorArg, predictor)) {
+        cerr << "Bad predictor: " << predictorArg << " (expected none|nottaken|btfn|bimodal|gshare|tage"
+             << "[,btb=N][,bits=N][,history=N] with a power-of-two BTB)" << endl;
+        return 1;
+    }
+
+    // Issue width, ports and stages, the same for every run
+    PipelineConfig issue;
+    if (!widthArg.empty()) {
+        vector<int> width;
+        if (!parseIntRange(widthArg, 1, width) || width.size() != 1 || width[0] > 8) {
+            cerr << "Bad issue width: " << widthArg << " (expected one value from 1 to 8)" << endl;
+            return 1;
+        }
+        issue.issueWidth = width[0];
+    }
+    if (!portsArg.empty() && !parsePortSpec(portsArg, issue)) {
+        cerr << "Bad ports: " << portsArg << " (expected mem=M,branch=B with counts of at least 1)" << endl;
+        return 1;
+    }
+    if (!pipelineArg.empty() && !parsePipelineLayout(pipelineArg, issue.layout)) {
+        cerr << "Bad pipeline: " << pipelineArg << " (expected 5, 7, 8 or stages in order from IF, IF1, IF2, ID, RR,"
+             << " EX, EX1, EX2, MEM, MEM1, MEM2 and WB, e.g. IF1,IF2,ID,EX,MEM1,MEM2,WB)" << endl;
+        return 1;
+    }
+    if (!windowArg.empty() && !parseOutOfOrderSpec(windowArg, issue.window)) {
+        cerr << "Bad window: " << windowArg << " (expected rob=N,iq=N,lsq=N,prf=N with at least 33 physical registers)" << endl;
+        return 1;
+    }
+
+    if (!sweepSource.empty()) {
+        SweepSpec spec;
+        uint64_t cycles;
+        if (!parseCount(args[0], cycles)) {
+            cerr << "Bad cycle count: " << args[0] << " (expected a whole number)" << endl;
+            return 1;
+        }
+        spec.issueWidth = issue.issueWidth;
+        spec.memPorts = issue.memPorts;
+        spec.branchUnits = issue.branchUnits;
+        spec.layout = issue.layout;
+        spec.l1i = l1i;
+        spec.l1d = l1d;
+        spec.predictor = predictor;
+        if ((!forwardingArg.empty() && !parseOnOff(forwardingArg, spec.forwarding)) ||
+            (!branchStageArg.empty() && !parseBranchStages(branchStageArg, spec.branchStages)) ||
+            (!loadLatencyArg.empty() && !parseIntRange(loadLatencyArg, 1, spec.loadLatencies)) ||
+            (!branchPenaltyArg.empty() && !parseIntRange(branchPenaltyArg, 0, spec.branchPenalties))) {
+            cerr << "Bad sweep range (expected e.g. --forwarding on,off --branch-stage id,ex --load-latency 1-3"
+                 << " --branch-penalty 0,1)" << endl;
+            return 1;
+        }
+        try {
+            vector<string> paths = listPrograms(sweepSource);
+            if (paths.empty()) {
+                cerr << "No programs found in " << sweepSource << endl;
+                return 1;
+            }
+            return runSweep(paths, spec, cycles, outDir, jobs) ? 1 : 0;
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    PipelineConfig config;
+    config.l1i = l1i;
+    config.l1d = l1d;
+    config.predictor = predictor;
+    config.issueWidth = issue.issueWidth;
+    config.memPorts = issue.memPorts;
+    config.branchUnits = issue.branchUnits;
+    config.layout = issue.layout;
+    config.window = issue.window;
+    vector<int> single;
+    if (!forwardingArg.empty()) {
+        cerr << "--forwarding is a sweep option; use --mode for single runs and batches" << endl;
+        return 1;
+    }
+    if (!branchStageArg.empty() && !parseBranchStage(branchStageArg, config.branchStage)) {
+        cerr << "Unknown branch stage: " << branchStageArg << " (expected id or ex)" << endl;
+        return 1;
+    }
+    if (!loadLatencyArg.empty()) {
+        if (!parseIntRange(loadLatencyArg, 1, single) || single.size() != 1) {
+            cerr << "Bad load latency: " << loadLatencyArg << " (expected one value of at least 1)" << endl;
+            return 1;
+        }
+        config.loadLatency = single[0];
+    }
+    if (!branchPenaltyArg.empty()) {
+        if (!parseIntRange(branchPenaltyArg, 0, single) || single.size() != 1) {
+            cerr << "Bad branch penalty: " << branchPenaltyArg << " (expected one value of at least 0)" << endl;
+            return 1;
+        }
+        config.branchPenalty = single[0];
+    }
+    if (modes.size() > 1 && !outPath.empty()) {
+        cerr << "--out names a single diagram; use --out-dir with more than one mode" << endl;
+        return 1;
+    }
+    if ((!checkpointPath.empty() || !restorePath.empty()) && (modes.size() > 1 || many)) {
+        cerr << "Checkpoints hold one processor; use them with a single --mode" << endl;
+        return 1;
+    }
+    if (!profilePath.empty() && many) {
+        cerr << "--profile covers a single run; use it without --batch or --sweep" << endl;
+        return 1;
+    }
+    if (!countersPath.empty() && many) {
+        cerr << "--counters reports a single run; batches and sweeps write their own summary" << endl;
+        return 1;
+    }
+    if (!checkpointPath.empty() && checkpointAtArg.empty() == checkpointEveryArg.empty()) {
+        cerr << "--checkpoint needs exactly one of --checkpoint-at or --checkpoint-every" << endl;
+        return 1;
+    }
+
+    if (!batchSource.empty()) {
+        BatchOptions options;
+        if (!parseCount(args[0], options.cycles)) {
+            cerr << "Bad cycle count: " << args[0] << " (expected a whole number)" << endl;
+            return 1;
+        }
+        try {
+            options.modes = modes;
+            options.config = config;
+            options.format = format;
+            options.outDir = outDir;
+            options.jobs = jobs;
+            vector<string> paths = listPrograms(batchSource);
+            if (paths.empty()) {
+                cerr << "No programs found in " << batchSource << endl;
+                return 1;
+            }
+            return runBatch(paths, options) ? 1 : 0;
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    string inputFile = args[0];
+    uint64_t cycles;
+    if (!parseCount(args[1], cycles)) {
+        cerr << "Bad cycle count: " << args[1] << " (expected a whole number)" << endl;
+        return 1;
+    }
+    string extension = (format == "binary") ? ".bin" : ".txt";
+    auto pathFor = [&](const string& name) {
+        return outPath.empty() ? outDir + "/" + name + "_out" + extension : outPath;
+    };
+
+    try {
+        // All modes share one loaded and predecoded program
+        Program program = loadProgram(inputFile);
+        if (!program.symbols.empty() && level > TraceLevel::Off) {
+            cout << "Loaded " << program.instrMemory.size() << " instructions at 0x" << hex << program.base
+                 << ", entry 0x" << program.entry << dec << " <" << program.symbolFor(program.entry) << ">, "
+                 << program.symbols.size() << " symbols\n";
+        }
+
+        // Fast-forward functionally, then time the rest in the pipeline
+        ArchState start = initialState(program);
+        if (!skipArg.empty() || !skipToArg.empty()) {
+            FunctionalSim functional(program);
+            auto begin = chrono::steady_clock::now();
+            if (!skipToArg.empty()) {
+                functional.runTo(uint32_t(stoul(skipToArg, nullptr, 0)), skipArg.empty() ? UINT64_MAX : stoull(skipArg));
+            } else {
+                functional.run(stoull(skipArg));
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            start = functional.archState();
+            if (level > TraceLevel::Off) {
+                cout << "Fast-forwarded " << functional.instructions() << " instructions to pc 0x" << hex << start.pc << dec
+                     << " in " << fixed << setprecision(3) << seconds * 1000 << " ms ("
+                     << setprecision(1) << functional.instructions() / max(seconds, 1e-9) / 1e6 << " MIPS)" << defaultfloat << "\n";
+            }
+        }
+
+        RunOptions run;
+        run.start = start;
+        run.config = config;
+        run.cycles = cycles;
+        run.level = level;
+        run.format = format;
+        run.restorePath = restorePath;
+        run.checkpointPath = checkpointPath;
+        if (!checkpointAtArg.empty()) run.checkpointAt = stoull(checkpointAtArg);
+        if (!checkpointEveryArg.empty()) run.checkpointEvery = stoull(checkpointEveryArg);
+        run.profileTop = profileTop;
+        run.profileFallback = filesystem::path(inputFile).stem().string();
+
+        vector<pair<string, SimResult>> results;
+        for (const ModeEntry& entry : modes) {
+            if (modes.size() > 1 && level > TraceLevel::Off) cout << "==== " << entry.name << " ====\n";
+            run.path = pathFor(entry.name);
+            if (!profilePath.empty()) {
+                run.profilePath = modes.size() > 1 ? profilePath + "." + entry.name : profilePath;
+            }
+            results.emplace_back(entry.name, entry.run(program, run));
+            if (results.back().second.paused && level > TraceLevel::Off) {
+                cout << "Checkpoint written to " << checkpointPath << " after cycle " << results.back().second.cycles << "\n";
+            }
+        }
+        if (!countersPath.empty()) {
+            writeCounters(countersPath, inputFile, config, results);
+            if (level > TraceLevel::Off) cout << "Counters written to " << countersPath << "\n";
+        }
+        if (results.size() > 1 && level > TraceLevel::Off) {
+            cout << "==== comparison ====\n";
+            for (auto& entry : results) {
+                cout << entry.first << ": " << entry.second.cycles << " cycles, "
+                     << entry.second.retired << " instructions";
+                if (entry.second.retired) {
+                    cout << ", CPI " << fixed << setprecision(3) << cpi(entry.second) << defaultfloat;
+                }
+                cout << "\n";
+            }
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
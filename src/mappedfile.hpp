@@ -0,0 +1,47 @@
+#pragma once
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Read-only mapping of a whole file, unmapped when it goes out of scope
+class MappedFile {
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Error opening file: " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw runtime_error("Error reading file: " + path);
+        }
+        length = size_t(st.st_size);
+        if (length > 0) {
+            void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("Error mapping file: " + path);
+            }
+            base = static_cast<const uint8_t*>(map);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (base) munmap(const_cast<uint8_t*>(base), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+};
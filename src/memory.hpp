@@ -0,0 +1,187 @@
+#pragma once
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// Sparse, byte-addressed data memory covering the whole 32-bit address
+// space. A two-level page table maps 4 KiB pages that are allocated on
+// first write; reading a page nobody wrote returns zeros without
+// allocating it. The last page touched is cached, so the common run of
+// accesses to one page skips the table walk.
+class PagedMemory {
+public:
+    static const uint32_t pageBits = 12;
+    static const uint32_t pageSize = 1u << pageBits;
+
+private:
+    static const uint32_t tableBits = 10; // Pages per second-level table: 1 << tableBits
+    using Page = array<uint8_t, pageSize>;
+    using Table = array<unique_ptr<Page>, 1u << tableBits>;
+
+    array<unique_ptr<Table>, 1u << (32 - pageBits - tableBits)> directory;
+    size_t pages = 0;
+    mutable uint32_t lastPage = UINT32_MAX; // Page number held in lastData
+    mutable uint8_t* lastData = nullptr;
+
+    Page* findPage(uint32_t page) const {
+        const unique_ptr<Table>& table = directory[page >> tableBits];
+        return table ? (*table)[page & ((1u << tableBits) - 1)].get() : nullptr;
+    }
+
+    // Start of the page holding addr for reading, nullptr if it was never written
+    const uint8_t* readPage(uint32_t addr) const {
+        uint32_t page = addr >> pageBits;
+        if (page == lastPage) return lastData;
+        Page* p = findPage(page);
+        if (!p) return nullptr;
+        lastPage = page;
+        lastData = p->data();
+        return lastData;
+    }
+
+    // Start of the page holding addr for writing, allocated on first touch
+    uint8_t* writePage(uint32_t addr) {
+        uint32_t page = addr >> pageBits;
+        if (page == lastPage) return lastData;
+        unique_ptr<Table>& table = directory[page >> tableBits];
+        if (!table) table = make_unique<Table>();
+        unique_ptr<Page>& p = (*table)[page & ((1u << tableBits) - 1)];
+        if (!p) {
+            p = make_unique<Page>();
+            p->fill(0);
+            pages++;
+        }
+        lastPage = page;
+        lastData = p->data();
+        return lastData;
+    }
+
+    static bool inOnePage(uint32_t addr, uint32_t width) {
+        return (addr & (pageSize - 1)) <= pageSize - width;
+    }
+
+public:
+    PagedMemory() = default;
+
+    PagedMemory(const PagedMemory& other) { *this = other; }
+
+    PagedMemory& operator=(const PagedMemory& other) {
+        if (this == &other) return *this;
+        clear();
+        other.forEachPage([&](uint32_t page, const uint8_t* data) {
+            memcpy(writePage(page << pageBits), data, pageSize);
+        });
+        return *this;
+    }
+
+    PagedMemory(PagedMemory&& other) noexcept { *this = move(other); }
+
+    PagedMemory& operator=(PagedMemory&& other) noexcept {
+        directory = move(other.directory);
+        pages = other.pages;
+        lastPage = other.lastPage;
+        lastData = other.lastData;
+        other.pages = 0;
+        other.lastPage = UINT32_MAX;
+        other.lastData = nullptr;
+        return *this;
+    }
+
+    void clear() {
+        for (unique_ptr<Table>& table : directory) table.reset();
+        pages = 0;
+        lastPage = UINT32_MAX;
+        lastData = nullptr;
+    }
+
+    // Pages allocated so far, i.e. 4 KiB units of memory actually in use
+    size_t pageCount() const { return pages; }
+
+    uint8_t load8(uint32_t addr) const {
+        const uint8_t* p = readPage(addr);
+        return p ? p[addr & (pageSize - 1)] : 0;
+    }
+
+    uint16_t load16(uint32_t addr) const {
+        if (!inOnePage(addr, 2)) return uint16_t(load8(addr) | load8(addr + 1) << 8);
+        const uint8_t* p = readPage(addr);
+        if (!p) return 0;
+        p += addr & (pageSize - 1);
+        return uint16_t(p[0] | p[1] << 8);
+    }
+
+    uint32_t load32(uint32_t addr) const {
+        if (!inOnePage(addr, 4)) return uint32_t(load16(addr)) | uint32_t(load16(addr + 2)) << 16;
+        const uint8_t* p = readPage(addr);
+        if (!p) return 0;
+        p += addr & (pageSize - 1);
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    void store8(uint32_t addr, uint8_t value) {
+        writePage(addr)[addr & (pageSize - 1)] = value;
+    }
+
+    void store16(uint32_t addr, uint16_t value) {
+        if (!inOnePage(addr, 2)) {
+            store8(addr, uint8_t(value));
+            store8(addr + 1, uint8_t(value >> 8));
+            return;
+        }
+        uint8_t* p = writePage(addr) + (addr & (pageSize - 1));
+        p[0] = uint8_t(value);
+        p[1] = uint8_t(value >> 8);
+    }
+
+    void store32(uint32_t addr, uint32_t value) {
+        if (!inOnePage(addr, 4)) {
+            store16(addr, uint16_t(value));
+            store16(addr + 2, uint16_t(value >> 16));
+            return;
+        }
+        uint8_t* p = writePage(addr) + (addr & (pageSize - 1));
+        p[0] = uint8_t(value);
+        p[1] = uint8_t(value >> 8);
+        p[2] = uint8_t(value >> 16);
+        p[3] = uint8_t(value >> 24);
+    }
+
+    // Copy size bytes into memory at addr, e.g. an initialised data section
+    void write(uint32_t addr, const uint8_t* bytes, size_t size) {
+        while (size > 0) {
+            size_t chunk = min<size_t>(size, pageSize - (addr & (pageSize - 1)));
+            memcpy(writePage(addr) + (addr & (pageSize - 1)), bytes, chunk);
+            addr += uint32_t(chunk);
+            bytes += chunk;
+            size -= chunk;
+        }
+    }
+
+    // Visit every allocated page in address order as (page number, 4 KiB of data)
+    template <typename F>
+    void forEachPage(F f) const {
+        for (uint32_t t = 0; t < directory.size(); t++) {
+            if (!directory[t]) continue;
+            const Table& table = *directory[t];
+            for (uint32_t i = 0; i < table.size(); i++) {
+                if (table[i]) f(t << tableBits | i, table[i]->data());
+            }
+        }
+    }
+
+    // Equal contents; a page never written equals a page of zeros
+    bool operator==(const PagedMemory& other) const {
+        auto covered = [](const PagedMemory& a, const PagedMemory& b) {
+            bool same = true;
+            a.forEachPage([&](uint32_t page, const uint8_t* data) {
+                const Page* p = b.findPage(page);
+                if (p ? memcmp(data, p->data(), pageSize) != 0 : any_of(data, data + pageSize, [](uint8_t x) { return x != 0; })) {
+                    same = false;
+                }
+            });
+            return same;
+        };
+        return covered(*this, other) && covered(other, *this);
+    }
+    bool operator!=(const PagedMemory& other) const { return !(*this == other); }
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "pipeline.hpp"
+
+// No-forwarding core: a consumer waits in ID until every producer it
+// depends on has left EX and MEM and will write the register file
+struct NoForwardingPolicy {
+    static constexpr const char* name = "noforward";
+    static constexpr bool forwards = false;
+
+    // Cycles after issue until a result can be read: ID reads the register
+    // file after write back
+    static int readyAfter(const ControlSignals& ctrl) {
+        (void)ctrl;
+        return 3;
+    }
+
+    // Check for stalls due to data hazards; waits is set to the registers
+    // not ready yet
+    static StallCause check_stall(const Scoreboard& scoreboard, uint64_t now, const PipelineRegisters& pipeRegs, const DecodedInstr& d,
+                                  const PipelineConfig& config, bool& is_nop, uint32_t& waits) {
+        (void)config; // Operands come from the register file wherever branches resolve
+
+        // The fetch squashed behind a branch waits as a noOp while the branch
+        // is in EX; with a predictor, what follows a branch is a real fetch
+        if(pipeRegs.id_ex.valid ){
+            if(pipeRegs.id_ex.ctrl.branch && pipeRegs.if_id.nop){ // beq, jal, jalr
+                is_nop=true;
+                return STALL_CONTROL;
+            }
+            else{
+                is_nop=false;
+            }
+        }
+
+        // The youngest producer waited on is still in EX, or in MEM
+        if ((waits = scoreboard.blocked(Scoreboard::sources(d), now))) {
+            return now - scoreboard.issuedAt(scoreboard.youngest(waits)) <= 1 ? STALL_RAW_EX : STALL_RAW_MEM;
+        }
+
+        return STALL_NONE;
+    }
+};
+
+using NoForwardingProcessor = Processor<NoForwardingPolicy>;
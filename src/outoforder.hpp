@@ -0,0 +1,624 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "pipeline.hpp"
+
+using namespace std;
+
+// Parse "rob=64,iq=16,lsq=16,prf=96": reorder buffer, issue queue and
+// load/store queue entries and physical registers, any subset of them
+inline bool parseOutOfOrderSpec(const string& text, OutOfOrderConfig& config) {
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) return false;
+        string key = item.substr(0, eq), value = item.substr(eq + 1);
+        if (value.empty() || value.size() > 4 || value.find_first_not_of("0123456789") != string::npos) return false;
+        int n = stoi(value);
+        if (n < 1) return false;
+        if (key == "rob") config.robEntries = n;
+        else if (key == "iq") config.iqEntries = n;
+        else if (key == "lsq") config.lsqEntries = n;
+        else if (key == "prf" && n > 32) config.physRegs = n;
+        else return false;
+    }
+    return true;
+}
+
+// One instruction in the reorder buffer, or in the fetch queue in front of it
+struct RobEntry {
+    uint32_t pc = 0;
+    uint32_t predicted_pc = 0; // Where fetch went after it
+    uint64_t seq = 0;          // Diagram row
+    uint64_t doneAt = 0;       // Once issued, the cycle its result is there
+    uint32_t address = 0;      // Loads and stores, once issued
+    uint32_t data = 0;         // Store data, once issued
+    uint32_t next = 0;         // pc after it, once issued
+    uint16_t dest = 0;         // Physical register renamed rd, 0 if it writes none
+    uint16_t prior = 0;        // What rd was mapped to before, freed when it commits
+    uint16_t src1 = 0, src2 = 0; // Physical registers of rs1 and rs2
+    bool taken = false;        // Branches, once issued
+    bool waiting = false;      // In the issue queue
+    bool issued = false;
+    bool done = false;
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& e) {
+        ar.field(e.pc);
+        ar.field(e.predicted_pc);
+        ar.field(e.seq);
+        ar.field(e.doneAt);
+        ar.field(e.address);
+        ar.field(e.data);
+        ar.field(e.next);
+        ar.field(e.dest);
+        ar.field(e.prior);
+        ar.field(e.src1);
+        ar.field(e.src2);
+        ar.field(e.taken);
+        ar.field(e.waiting);
+        ar.field(e.issued);
+        ar.field(e.done);
+    }
+};
+
+// Out-of-order core after Tomasulo, with a reorder buffer and an explicit
+// physical register file:
+//
+//   fetch     up to issueWidth instructions per cycle, as SlotPipeline does,
+//             following the branch predictor (without one, fetch waits
+//             behind every branch until it executes)
+//   dispatch  in order, renaming rs1, rs2 and rd through the map table into
+//             a reorder buffer entry, an issue queue entry and, for loads
+//             and stores, a load/store queue entry; stalls when any of
+//             them, or a free physical register, runs out
+//   issue     the oldest instructions whose operands are ready, up to
+//             issueWidth per cycle within the memory ports and branch
+//             units. ALU results can be used the next cycle, loads after
+//             the load latency and any data cache miss. A load waits for
+//             every older store's address and takes an older word store to
+//             the same address from the queue; other overlaps wait for the
+//             store to commit.
+//   complete branches compare their outcome with the prediction; a
+//             mispredict squashes everything younger, rolls the map table
+//             back and restarts fetch
+//   commit    in order, up to issueWidth per cycle: stores write memory,
+//             rd's previous physical register is freed and the predictor
+//             is trained, so it learns in program order
+//
+// It has no hazard policy: operands always come from the physical
+// registers, and --pipeline and --branch-stage do not apply. The diagram
+// shows IF at fetch, ID at dispatch, EX at issue, MEM the cycle after a
+// load or store issues and WB at commit.
+class OutOfOrderProcessor : public CoreDriver<OutOfOrderProcessor> {
+public:
+    static constexpr const char* name = "ooo";
+
+private:
+    friend class CoreDriver<OutOfOrderProcessor>;
+
+    const Program& program; // Shared, read-only
+    PipelineConfig config;
+    size_t width;
+    vector<uint32_t> registers; // Committed architectural registers
+    PagedMemory dataMemory;     // Committed stores only
+    vector<uint32_t> values;    // Physical register file; 0 is x0
+    vector<uint64_t> readyAt;   // Cycle from which each physical register can be read
+    vector<uint16_t> freeRegs;  // Physical registers nothing is mapped to
+    array<uint16_t, 32> renameMap{}; // Architectural to physical, as of the youngest dispatched
+    vector<RobEntry> rob;       // Circular, robCount entries from robHead, oldest first
+    vector<ReturnStack> robStacks; // Return stack fetch left behind each branch in the ROB
+    size_t robHead = 0, robCount = 0;
+    vector<RobEntry> fetched;   // Fetched, not yet dispatched, oldest first
+    vector<ReturnStack> fetchedStacks;
+    int iqCount = 0, lsqCount = 0;
+    uint32_t pc = 0;
+    uint32_t commit_pc = 0; // pc after the last committed instruction
+    uint64_t cycle = 0; // Cycles simulated so far, across checkpoints
+    int fetch_block = 0; // Fetch cycles still lost to a redirect's branch penalty
+    bool fetch_held = false; // No predictor: fetch waits for the branch it stopped behind
+    uint32_t branch_source = 0; // pc of the branch fetch is waiting for or was redirected by
+    int fetch_wait = 0; // Cycles until the line holding pc arrives
+    bool fetch_missed = false; // pc has already been looked up and missed
+    Cache icache, dcache;
+    BranchPredictor predictor;
+    HotspotProfiler* profiler = nullptr; // Charged with every lost cycle while set
+    uint64_t retired = 0;
+    uint64_t stall_cycles = 0;
+    array<uint64_t, NUM_STALL_CAUSES> stall_causes{};
+    uint64_t branch_bubbles = 0;
+    uint64_t mem_stall_cycles = 0;
+    uint64_t fetch_stall_cycles = 0;
+    array<vector<uint64_t>, NUM_WINDOWS> occupancy;
+    StageTracker tracker; // In-flight rows of the pipeline diagram
+
+    // Only branches leave a return stack behind; other slots hold an empty one
+    template <typename Archive, typename Stack>
+    static void stackField(Archive& ar, Stack& stack, uint32_t rasEntries) {
+        bool kept = stack.capacity() != 0;
+        ar.field(kept);
+        if constexpr (!is_const<Stack>::value) stack = ReturnStack(kept ? rasEntries : 0);
+        if (kept) ar.field(stack);
+    }
+
+    // Every field a checkpoint carries, in file order
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) {
+        ar.field(p.cycle);
+        ar.field(p.pc);
+        ar.field(p.commit_pc);
+        ar.field(p.fetch_block);
+        ar.field(p.fetch_held);
+        ar.field(p.branch_source);
+        ar.field(p.fetch_wait);
+        ar.field(p.fetch_missed);
+        ar.field(p.retired);
+        ar.field(p.stall_cycles);
+        ar.field(p.stall_causes);
+        ar.field(p.branch_bubbles);
+        ar.field(p.mem_stall_cycles);
+        ar.field(p.fetch_stall_cycles);
+        ar.array(p.registers, 32);
+        ar.memory(p.dataMemory);
+        ar.array(p.values, p.values.size());
+        ar.array(p.readyAt, p.readyAt.size());
+        ar.array(p.freeRegs);
+        ar.field(p.renameMap);
+        ar.array(p.rob, p.rob.size());
+        ar.field(p.robHead);
+        ar.field(p.robCount);
+        for (auto& stack : p.robStacks) stackField(ar, stack, p.config.predictor.rasEntries);
+        ar.array(p.fetched);
+        if constexpr (!is_const<Self>::value) p.fetchedStacks.resize(p.fetched.size());
+        for (auto& stack : p.fetchedStacks) stackField(ar, stack, p.config.predictor.rasEntries);
+        ar.field(p.iqCount);
+        ar.field(p.lsqCount);
+        for (auto& histogram : p.occupancy) ar.array(histogram, histogram.size());
+        ar.field(p.icache);
+        ar.field(p.dcache);
+        ar.field(p.predictor);
+    }
+
+    // Width and window sizes, which a checkpoint must match
+    string shape() const {
+        const OutOfOrderConfig& w = config.window;
+        return string(name) + ", " + to_string(width) + "-wide, rob=" + to_string(w.robEntries) + ",iq=" +
+               to_string(w.iqEntries) + ",lsq=" + to_string(w.lsqEntries) + ",prf=" + to_string(w.physRegs);
+    }
+
+    const DecodedInstr& decoded(const RobEntry& op) const { return program.decoded[program.index(op.pc)]; }
+
+    // The i-th oldest entry of the reorder buffer
+    RobEntry& robAt(size_t i) { return rob[(robHead + i) % rob.size()]; }
+    const RobEntry& robAt(size_t i) const { return rob[(robHead + i) % rob.size()]; }
+
+    static bool isMemory(const DecodedInstr& d) { return d.ctrl.memRead || d.ctrl.memWrite; }
+    static uint32_t accessBytes(const DecodedInstr& d) { return (d.funct3 & 3) == 0 ? 1 : (d.funct3 & 3) == 1 ? 2 : 4; }
+
+    // An instruction dispatched on a wrong path leaves again: its rename is
+    // undone, youngest first, and its queue entries are freed
+    void squash(RobEntry& op, uint32_t source) {
+        const DecodedInstr& d = decoded(op);
+        if (op.dest) {
+            renameMap[d.rd] = op.prior;
+            freeRegs.push_back(op.dest);
+        }
+        iqCount -= op.waiting;
+        lsqCount -= isMemory(d);
+        tracker.squash(op.seq);
+        branch_bubbles++;
+        if (profiler) profiler->charge(source, COST_BRANCH);
+    }
+
+    // The branch i-th oldest in the ROB went elsewhere than fetch did:
+    // everything younger goes and fetch restarts at its outcome
+    void recover(size_t i) {
+        RobEntry& branch = robAt(i);
+        for (size_t j = robCount; j-- > i + 1;) squash(robAt(j), branch.pc);
+        robCount = i + 1;
+        for (RobEntry& wrong : fetched) {
+            tracker.squash(wrong.seq);
+            branch_bubbles++;
+            if (profiler) profiler->charge(branch.pc, COST_BRANCH);
+        }
+        fetched.clear();
+        fetchedStacks.clear();
+        if (predictor.enabled()) predictor.restoreReturnStack(robStacks[(robHead + i) % rob.size()]);
+        pc = branch.next;
+        fetch_block = config.branchPenalty;
+        fetch_held = false;
+        fetch_wait = 0;
+        fetch_missed = false;
+        branch_source = branch.pc;
+    }
+
+    // Mark what finishes executing this cycle; branches resolve, oldest first
+    void complete() {
+        for (size_t i = 0; i < robCount; i++) {
+            RobEntry& op = robAt(i);
+            if (!op.issued || op.done || op.doneAt > cycle) continue;
+            op.done = true;
+            if (!decoded(op).ctrl.branch) continue;
+            if (!predictor.enabled()) {
+                // Fetch stopped behind this branch and goes on from its outcome
+                pc = op.next;
+                fetch_held = false;
+                fetch_block = config.branchPenalty;
+                branch_source = op.pc;
+            } else if (op.next != op.predicted_pc) {
+                recover(i);
+                return;
+            }
+        }
+    }
+
+    // Commit finished instructions in order. Returns the number committed.
+    size_t commit() {
+        size_t committed = 0;
+        while (committed < width && robCount > 0 && robAt(0).done) {
+            RobEntry& op = robAt(0);
+            const DecodedInstr& d = decoded(op);
+            if (d.ctrl.memWrite) {
+                storeData(dataMemory, op.address, op.data, d.funct3);
+                dcache.access(op.address, true); // Drains from a store buffer, off the critical path
+            }
+            if (op.dest) {
+                registers[d.rd] = values[op.dest];
+                freeRegs.push_back(op.prior);
+            }
+            lsqCount -= isMemory(d);
+            if (d.ctrl.branch && predictor.enabled()) predictor.resolve(d, op.pc, op.taken, op.next, op.predicted_pc, false);
+            commit_pc = op.next;
+            tracker.enter(op.seq, STAGE_WB, int64_t(cycle), uint8_t(committed));
+            retired++;
+            committed++;
+            robHead = (robHead + 1) % rob.size();
+            robCount--;
+        }
+        // A load still in memory holds up commit
+        if (robCount > 0 && committed < width) {
+            const RobEntry& head = robAt(0);
+            if (head.issued && !head.done && decoded(head).ctrl.memRead) {
+                mem_stall_cycles++;
+                if (profiler) profiler->charge(head.pc, COST_MEMORY);
+            }
+        }
+        return committed;
+    }
+
+    // Whether the load i-th oldest in the ROB can read address now, and
+    // whether an older store hands it its data
+    bool loadReady(size_t i, uint32_t address, uint32_t bytes, bool& forwarded, uint32_t& data) {
+        forwarded = false;
+        for (size_t j = 0; j < i; j++) {
+            const RobEntry& older = robAt(j);
+            const DecodedInstr& s = decoded(older);
+            if (!s.ctrl.memWrite) continue;
+            if (!older.issued) return false; // Address not known yet
+            uint32_t size = accessBytes(s);
+            if (older.address + size <= address || address + bytes <= older.address) continue;
+            forwarded = older.address == address && size == 4 && bytes == 4;
+            if (!forwarded) return false;
+            data = older.data; // The youngest overlapping store wins
+        }
+        return true;
+    }
+
+    // Issue up to width ready instructions, oldest first. Returns the
+    // number issued.
+    size_t issue() {
+        size_t issued = 0;
+        int memOps = 0, branchOps = 0;
+        for (size_t i = 0; i < robCount && issued < width; i++) {
+            RobEntry& op = robAt(i);
+            if (!op.waiting || readyAt[op.src1] > cycle || readyAt[op.src2] > cycle) continue;
+            const DecodedInstr& d = decoded(op);
+            bool mem = isMemory(d);
+            if ((mem && memOps == config.memPorts) || (d.ctrl.branch && branchOps == config.branchUnits)) continue;
+            uint32_t a = values[op.src1], b = values[op.src2];
+            uint32_t result = aluResult(d, op.pc, a, b);
+            op.doneAt = cycle + 1;
+            if (d.ctrl.memRead) {
+                bool forwarded;
+                uint32_t data = 0;
+                if (!loadReady(i, result, accessBytes(d), forwarded, data)) continue;
+                op.address = result;
+                int latency = config.loadLatency;
+                if (forwarded) {
+                    result = data;
+                } else {
+                    latency += dcache.access(op.address, false);
+                    result = loadData(dataMemory, op.address, d.funct3);
+                }
+                op.doneAt = cycle + 1 + latency;
+            } else if (d.ctrl.memWrite) {
+                op.address = result;
+                op.data = b;
+                op.doneAt = cycle + 2;
+            }
+            op.taken = d.ctrl.branch && (d.opcode != 0x63 || branchTaken(d, a, b));
+            op.next = op.taken ? branchTarget(d, op.pc, a) : op.pc + 4;
+            if (op.dest) {
+                values[op.dest] = result;
+                readyAt[op.dest] = op.doneAt;
+            }
+            op.waiting = false;
+            op.issued = true;
+            iqCount--;
+            memOps += mem;
+            branchOps += d.ctrl.branch;
+            tracker.enter(op.seq, STAGE_EX, int64_t(cycle), uint8_t(issued));
+            if (mem) tracker.enter(op.seq, STAGE_MEM, int64_t(cycle + 1), uint8_t(issued));
+            issued++;
+        }
+        return issued;
+    }
+
+    // What keeps d from dispatching: the first window structure it needs
+    // that is full
+    StallCause dispatchStall(const DecodedInstr& d) const {
+        if (robCount == rob.size()) return STALL_ROB_FULL;
+        if (iqCount == config.window.iqEntries) return STALL_IQ_FULL;
+        if (isMemory(d) && lsqCount == config.window.lsqEntries) return STALL_LSQ_FULL;
+        if (d.ctrl.regWrite && d.rd != 0 && freeRegs.empty()) return STALL_REGS_FULL;
+        return STALL_NONE;
+    }
+
+    // Rename and dispatch fetched instructions in order. Returns the number
+    // dispatched.
+    size_t dispatch() {
+        size_t dispatched = 0;
+        StallCause cause = STALL_NONE;
+        while (dispatched < width && dispatched < fetched.size()) {
+            RobEntry op = fetched[dispatched];
+            const DecodedInstr& d = decoded(op);
+            bool mem = isMemory(d), writes = d.ctrl.regWrite && d.rd != 0;
+            cause = dispatchStall(d);
+            if (cause != STALL_NONE) break;
+            op.src1 = d.uses_rs1 ? renameMap[d.rs1] : 0;
+            op.src2 = d.uses_rs2 ? renameMap[d.rs2] : 0;
+            if (writes) {
+                op.prior = renameMap[d.rd];
+                op.dest = freeRegs.back();
+                freeRegs.pop_back();
+                renameMap[d.rd] = op.dest;
+                readyAt[op.dest] = UINT64_MAX;
+            }
+            op.waiting = true;
+            iqCount++;
+            lsqCount += mem;
+            size_t at = (robHead + robCount) % rob.size();
+            rob[at] = op;
+            if (d.ctrl.branch && predictor.enabled()) robStacks[at] = fetchedStacks[dispatched];
+            robCount++;
+            tracker.enter(op.seq, STAGE_ID, int64_t(cycle), uint8_t(dispatched));
+            dispatched++;
+        }
+        fetched.erase(fetched.begin(), fetched.begin() + dispatched);
+        fetchedStacks.erase(fetchedStacks.begin(), fetchedStacks.begin() + dispatched);
+        // The oldest instruction in the window is what the rest waits on
+        if (cause != STALL_NONE) {
+            stall_causes[cause]++;
+            stall_cycles += dispatched == 0;
+            if (profiler) profiler->charge(robCount ? robAt(0).pc : fetched[0].pc, COST_STALL);
+        }
+        return dispatched;
+    }
+
+    // Fetch a group into the free room of the fetch queue
+    void fetch() {
+        if (fetch_block > 0 || fetch_held) {
+            if (fetch_block > 0) fetch_block--;
+            branch_bubbles++;
+            if (profiler) profiler->charge(branch_source, COST_BRANCH);
+            return;
+        }
+        if (fetched.size() == width || !program.contains(pc)) return;
+        // An instruction cache miss holds fetch at pc until the line arrives
+        if (icache.enabled()) {
+            if (!fetch_missed) {
+                fetch_wait = icache.access(pc, false);
+                fetch_missed = fetch_wait > 0;
+            }
+            if (fetch_wait > 0) {
+                fetch_wait--;
+                fetch_stall_cycles++;
+                if (profiler) profiler->charge(pc, COST_FETCH);
+                return;
+            }
+            fetch_missed = false;
+        }
+        // The group stays on one cache line and ends after a predicted-taken branch
+        uint32_t line = pc / config.l1i.lineSize;
+        for (uint8_t k = 0; fetched.size() < width && program.contains(pc) && (!icache.enabled() || pc / config.l1i.lineSize == line); k++) {
+            RobEntry op;
+            op.pc = pc;
+            op.seq = tracker.open(pc);
+            tracker.enter(op.seq, STAGE_IF, int64_t(cycle), k);
+            const DecodedInstr& d = decoded(op);
+            if (predictor.enabled()) {
+                op.predicted_pc = predictor.predict(pc);
+                fetchedStacks.push_back(d.ctrl.branch ? predictor.returnStack() : ReturnStack());
+            } else {
+                op.predicted_pc = pc + 4;
+                fetchedStacks.push_back(ReturnStack());
+                if (d.ctrl.branch) {
+                    fetch_held = true;
+                    branch_source = pc;
+                }
+            }
+            fetched.push_back(op);
+            pc = op.predicted_pc;
+            if (fetch_held || pc != op.pc + 4) break;
+        }
+    }
+
+    // Count n cycles into the occupancy histograms
+    void sampleOccupancy(uint64_t n = 1) {
+        occupancy[WINDOW_ROB][robCount] += n;
+        occupancy[WINDOW_IQ][size_t(iqCount)] += n;
+        occupancy[WINDOW_LSQ][size_t(lsqCount)] += n;
+        occupancy[WINDOW_RENAME][size_t(config.window.physRegs - 32) - freeRegs.size()] += n;
+    }
+
+    // Cycles after this one in which nothing but the counters would change:
+    // nothing completes, commits, issues, dispatches or is fetched, until
+    // the first result in flight is there, an operand becomes ready or an
+    // instruction cache miss ends
+    uint64_t idleCycles() const {
+        if (fetch_block > 0 || (robCount > 0 && robAt(0).done)) return 0;
+        if (!fetched.empty() && dispatchStall(decoded(fetched[0])) == STALL_NONE) return 0;
+        uint64_t next = UINT64_MAX; // The first cycle that can change anything
+        for (size_t i = 0; i < robCount; i++) {
+            const RobEntry& op = robAt(i);
+            if (op.issued && !op.done) next = min(next, op.doneAt);
+            else if (op.waiting) next = min(next, max(readyAt[op.src1], readyAt[op.src2]));
+        }
+        if (!fetch_held && fetched.size() < width && program.contains(pc)) {
+            if (!icache.enabled() || !fetch_missed || fetch_wait == 0) return 0;
+            next = min(next, cycle + uint64_t(fetch_wait));
+        }
+        return next != UINT64_MAX && next > cycle ? next - cycle : 0;
+    }
+
+    // Jump over n idle cycles, counting them as fetch(), dispatch() and
+    // commit() would have
+    template <TraceLevel L>
+    void skipIdle(uint64_t n) {
+        if (fetch_held) {
+            branch_bubbles += n;
+            if (profiler) profiler->charge(branch_source, COST_BRANCH, n);
+        } else if (fetched.size() < width && program.contains(pc)) {
+            fetch_wait -= int(n);
+            fetch_stall_cycles += n;
+            if (profiler) profiler->charge(pc, COST_FETCH, n);
+        }
+        if (!fetched.empty()) {
+            stall_causes[dispatchStall(decoded(fetched[0]))] += n;
+            stall_cycles += n;
+            if (profiler) profiler->charge(robCount ? robAt(0).pc : fetched[0].pc, COST_STALL, n);
+        }
+        if (robCount > 0 && robAt(0).issued && decoded(robAt(0)).ctrl.memRead) {
+            mem_stall_cycles += n;
+            if (profiler) profiler->charge(robAt(0).pc, COST_MEMORY, n);
+        }
+        sampleOccupancy(n);
+        cycle += n;
+    }
+
+    // Whether restored state fits the window and the program: the circular
+    // buffer bounds, physical register numbers and every instruction's pc
+    bool consistent(const vector<StageRecord>& records) const {
+        const OutOfOrderConfig& w = config.window;
+        size_t phys = size_t(w.physRegs);
+        if (robHead >= rob.size() || robCount > rob.size() || freeRegs.size() > phys - 32) return false;
+        if (iqCount < 0 || iqCount > w.iqEntries || lsqCount < 0 || lsqCount > w.lsqEntries) return false;
+        if (fetched.size() > width) return false;
+        for (uint16_t r : freeRegs) if (r >= phys) return false;
+        for (uint16_t r : renameMap) if (r >= phys) return false;
+        auto valid = [&](const RobEntry& e) {
+            return program.contains(e.pc) && e.dest < phys && e.prior < phys && e.src1 < phys && e.src2 < phys;
+        };
+        for (size_t k = 0; k < robCount; k++) if (!valid(rob[(robHead + k) % rob.size()])) return false;
+        for (const RobEntry& e : fetched) if (!valid(e)) return false;
+        for (const StageRecord& rec : records) if (!program.contains(rec.pc)) return false;
+        return true;
+    }
+
+public:
+    OutOfOrderProcessor(const Program& program, const PipelineConfig& config = PipelineConfig())
+        : OutOfOrderProcessor(program, initialState(program), config) {}
+
+    // Start with an empty window at state.pc, e.g. after a functional fast-forward
+    OutOfOrderProcessor(const Program& program, const ArchState& state, const PipelineConfig& config = PipelineConfig())
+        : program(program), config(config), width(size_t(max(1, config.issueWidth))), registers(state.registers),
+          dataMemory(state.dataMemory), pc(state.pc), commit_pc(state.pc), icache(config.l1i), dcache(config.l1d),
+          predictor(config.predictor) {
+        const OutOfOrderConfig& w = config.window;
+        // x0..x31 start out in physical registers 0..31, with x0 pinned to 0
+        values.assign(size_t(w.physRegs), 0);
+        readyAt.assign(size_t(w.physRegs), 0);
+        for (uint16_t r = 0; r < 32; r++) {
+            renameMap[r] = r;
+            values[r] = r ? registers[r] : 0;
+        }
+        for (int p = w.physRegs - 1; p >= 32; p--) freeRegs.push_back(uint16_t(p));
+        rob.resize(size_t(w.robEntries));
+        robStacks.resize(size_t(w.robEntries));
+        occupancy[WINDOW_ROB].assign(size_t(w.robEntries) + 1, 0);
+        occupancy[WINDOW_IQ].assign(size_t(w.iqEntries) + 1, 0);
+        occupancy[WINDOW_LSQ].assign(size_t(w.lsqEntries) + 1, 0);
+        occupancy[WINDOW_RENAME].assign(size_t(w.physRegs - 32) + 1, 0);
+    }
+
+    // Save the complete simulator state, as Processor::saveCheckpoint() does
+    void saveCheckpoint(const string& path) const {
+        CheckpointWriter out;
+        out.magic();
+        out.text(shape());
+        out.field(programHash(program.instrMemory));
+        out.field(uint32_t(program.instrMemory.size()));
+        checkpointFields(out, *this);
+        out.field(tracker.nextSeq());
+        out.array(tracker.inflightRecords());
+        out.save(path);
+    }
+
+    // Resume from a checkpoint taken on the same program, width and window
+    void restoreCheckpoint(const string& path) {
+        CheckpointReader in(path);
+        in.magic();
+        string taken;
+        in.text(taken);
+        if (taken != shape()) {
+            throw runtime_error("checkpoint " + path + " was taken in " + taken + " mode");
+        }
+        uint64_t hash;
+        uint32_t size;
+        in.field(hash);
+        in.field(size);
+        if (hash != programHash(program.instrMemory) || size != program.instrMemory.size()) {
+            throw runtime_error("checkpoint " + path + " was taken on a different program");
+        }
+        checkpointFields(in, *this);
+        uint64_t seq;
+        vector<StageRecord> records;
+        in.field(seq);
+        in.array(records);
+        if (!consistent(records)) {
+            throw runtime_error("checkpoint " + path + " holds a window or pc this core cannot have");
+        }
+        tracker.restore(records, seq);
+    }
+
+    // Charge lost cycles to the profiler, which must also be the diagram
+    // writer simulate() is given; nullptr to stop
+    void setProfiler(HotspotProfiler* p) { profiler = p; }
+
+    // Simulate one cycle
+    template <TraceLevel L>
+    void step() {
+        TraceStream<(L >= TraceLevel::Cycle)> trace;
+        trace << "Cycle " << cycle + 1 << ":\n";
+        // Back to front, so each step sees the room the later ones left
+        complete();
+        size_t committed = commit();
+        size_t issued = issue();
+        size_t dispatched = dispatch();
+        fetch();
+        tracker.drain();
+        sampleOccupancy();
+        trace << "Committed: " << committed << ", issued: " << issued << ", dispatched: " << dispatched
+              << ", in flight: " << robCount << "\n";
+        trace << "----------------------------------------\n";
+        cycle++;
+    }
+
+    bool drained() const { return robCount == 0 && fetched.empty() && !program.contains(pc); }
+
+private:
+    // The architectural pc is the one after the last commit, not fetch's
+    uint32_t archPc() const { return commit_pc; }
+
+    void finishResult(SimResult& result) const { result.occupancy = occupancy; }
+};
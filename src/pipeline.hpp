@@ -0,0 +1,1056 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "trace.hpp"
+#include "isa.hpp"
+#include "program.hpp"
+#include "checkpoint.hpp"
+#include "cache.hpp"
+#include "predictor.hpp"
+#include "profile.hpp"
+#include "scoreboard.hpp"
+
+using namespace std;
+
+// Struct for pipeline registers
+struct PipelineRegisters {
+    struct IF_ID {
+        uint32_t instr = 0; uint32_t pc = 0; uint32_t predicted_pc = 0; uint64_t seq = 0; bool valid = false; bool nop = false;
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& r) {
+            ar.field(r.instr); ar.field(r.pc); ar.field(r.predicted_pc); ar.field(r.seq); ar.field(r.valid); ar.field(r.nop);
+        }
+    };
+    struct ID_EX {
+        uint32_t pc = 0;
+        uint32_t predicted_pc = 0; // Where fetch went after this instruction
+        uint64_t seq = 0; // Diagram row, 0 for bubbles
+        uint32_t rs1 = 0, rs2 = 0, rd = 0, opcode = 0;
+        int32_t imm = 0;
+        uint32_t rs1_val = 0, rs2_val = 0; // Added for forwarding
+        ControlSignals ctrl;
+        bool valid = false;
+        bool stall = false;
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& r) {
+            ar.field(r.pc); ar.field(r.predicted_pc); ar.field(r.seq);
+            ar.field(r.rs1); ar.field(r.rs2); ar.field(r.rd); ar.field(r.opcode);
+            ar.field(r.imm); ar.field(r.rs1_val); ar.field(r.rs2_val);
+            ar.field(r.ctrl); ar.field(r.valid); ar.field(r.stall);
+        }
+    };
+    struct EX_MEM {
+        uint32_t alu_result = 0, rs2 = 0, rs2_val = 0, rd = 0, pc = 0; uint64_t seq = 0; bool stall = false; ControlSignals ctrl; bool valid = false; bool is_zero = false;
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& r) {
+            ar.field(r.alu_result); ar.field(r.rs2); ar.field(r.rs2_val); ar.field(r.rd); ar.field(r.pc);
+            ar.field(r.seq); ar.field(r.stall); ar.field(r.ctrl); ar.field(r.valid); ar.field(r.is_zero);
+        }
+    };
+    struct MEM_WB {
+        uint32_t mem_data = 0, alu_result = 0, rd = 0, pc = 0; uint64_t seq = 0; bool stall = false; ControlSignals ctrl; bool valid = false;
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& r) {
+            ar.field(r.mem_data); ar.field(r.alu_result); ar.field(r.rd); ar.field(r.pc);
+            ar.field(r.seq); ar.field(r.stall); ar.field(r.ctrl); ar.field(r.valid);
+        }
+    };
+
+    IF_ID if_id;
+    ID_EX id_ex;
+    EX_MEM ex_mem;
+    MEM_WB mem_wb;
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& r) {
+        ar.field(r.if_id); ar.field(r.id_ex); ar.field(r.ex_mem); ar.field(r.mem_wb);
+    }
+};
+
+// Why decode held its instruction in a cycle, as check_stall() reports it
+enum StallCause {
+    STALL_NONE = 0,
+    STALL_LOAD_USE,       // Forwarding: a load in EX feeds the instruction in ID
+    STALL_RAW_EX,         // No forwarding: a producer is still in EX
+    STALL_RAW_MEM,        // No forwarding: a producer is still in MEM
+    STALL_BRANCH_OPERAND, // Forwarding: a branch resolving in ID needs a value not yet computed or loaded
+    STALL_CONTROL,        // The noOp fetched behind a branch waits while the branch is in EX
+    STALL_PAIRING,        // Wide issue: an older instruction in the same issue group produces an operand
+    STALL_PORT,           // Wide issue: the cycle's memory ports or branch units are taken
+    STALL_ROB_FULL,       // Out of order: no reorder buffer entry to dispatch into
+    STALL_IQ_FULL,        // Out of order: the issue queue is full
+    STALL_LSQ_FULL,       // Out of order: the load/store queue is full
+    STALL_REGS_FULL,      // Out of order: no free physical register to rename rd to
+    NUM_STALL_CAUSES
+};
+
+static const char* const stallCauseNames[NUM_STALL_CAUSES] = {"none", "load_use", "raw_ex", "raw_mem", "branch_operand", "control",
+                                                              "pairing", "port", "rob_full", "iq_full", "lsq_full", "regs_full"};
+
+// Structures of the out-of-order window whose occupancy is sampled every cycle
+enum WindowKind {
+    WINDOW_ROB = 0, // Reorder buffer entries
+    WINDOW_IQ,      // Issue queue entries
+    WINDOW_LSQ,     // Loads and stores in flight
+    WINDOW_RENAME,  // Physical registers held by writes not yet committed
+    NUM_WINDOWS
+};
+
+static const char* const windowNames[NUM_WINDOWS] = {"rob", "iq", "lsq", "rename"};
+
+// Sizes of the out-of-order window
+struct OutOfOrderConfig {
+    int robEntries = 64; // Reorder buffer
+    int iqEntries = 16;  // Issue queue: dispatched, not yet issued
+    int lsqEntries = 16; // Loads and stores between dispatch and commit
+    int physRegs = 96;   // Physical registers, 32 of them mapped to committed state
+};
+
+// Timing parameters of the pipeline. The defaults are the original
+// hardwired behaviour: branches resolve in ID with one bubble, loads
+// spend a single cycle in MEM and there are no caches.
+struct PipelineConfig {
+    Stage branchStage = STAGE_ID; // STAGE_ID or STAGE_EX
+    int branchPenalty = 0;        // Extra fetch bubbles after a branch resolves
+    int loadLatency = 1;          // Cycles a load occupies MEM
+    CacheConfig l1i, l1d;         // Disabled unless given a size
+    PredictorConfig predictor;    // None: squash fetch behind every branch
+    int issueWidth = 1;           // Instructions fetched, issued and retired per cycle
+    int memPorts = 1;             // Loads and stores issued per cycle when wider than 1
+    int branchUnits = 1;          // Branches and jumps issued per cycle when wider than 1
+    OutOfOrderConfig window;      // Used by the out-of-order core only
+    // The stages front to back; a stage listed twice is split in two
+    // (IF/IF2, ID/RR, EX/EX2, MEM/MEM2). Anything but the classic five
+    // runs on SlotPipeline.
+    vector<Stage> layout = {STAGE_IF, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_WB};
+
+    // Whether the five-stage Processor models this configuration
+    bool classic() const { return issueWidth == 1 && layout.size() == NUM_STAGES; }
+
+    // Fetches squashed behind every branch without a predictor, or behind a
+    // mispredicted one with it
+    int branchBubbles() const { return (branchStage - STAGE_IF) + branchPenalty; }
+};
+
+// Name of a layout, as parsePipelineLayout() reads it: "IF,IF2,ID,EX,MEM,WB"
+inline string layoutName(const vector<Stage>& layout) {
+    string name;
+    for (size_t s = 0; s < layout.size(); s++) {
+        if (s) name += ",";
+        name += s && layout[s - 1] == layout[s] ? splitStageNames[layout[s]] : stageNames[layout[s]];
+    }
+    return name;
+}
+
+// Parse a stage list such as "IF1,IF2,ID,RR,EX,MEM1,MEM2,WB", or "5", "7"
+// or "8" for the classic pipeline, split fetch and memory, and those plus a
+// register-read stage. Every stage appears in order, at most twice; WB once.
+inline bool parsePipelineLayout(const string& text, vector<Stage>& layout) {
+    static const map<string, vector<Stage>> presets = {
+        {"5", {STAGE_IF, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_WB}},
+        {"7", {STAGE_IF, STAGE_IF, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_MEM, STAGE_WB}},
+        {"8", {STAGE_IF, STAGE_IF, STAGE_ID, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_MEM, STAGE_WB}},
+    };
+    static const map<string, pair<Stage, bool>> names = {
+        {"IF", {STAGE_IF, false}},   {"IF1", {STAGE_IF, false}},   {"IF2", {STAGE_IF, true}},
+        {"ID", {STAGE_ID, false}},   {"RR", {STAGE_ID, true}},
+        {"EX", {STAGE_EX, false}},   {"EX1", {STAGE_EX, false}},   {"EX2", {STAGE_EX, true}},
+        {"MEM", {STAGE_MEM, false}}, {"MEM1", {STAGE_MEM, false}}, {"MEM2", {STAGE_MEM, true}},
+        {"WB", {STAGE_WB, false}},
+    };
+    auto preset = presets.find(text);
+    if (preset != presets.end()) {
+        layout = preset->second;
+        return true;
+    }
+    layout.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        transform(item.begin(), item.end(), item.begin(), ::toupper);
+        auto it = names.find(item);
+        if (it == names.end()) return false;
+        auto [stage, second] = it->second;
+        // Each stage follows the one before it; a second half its own first half
+        bool follows = second ? !layout.empty() && layout.back() == stage && (layout.size() < 2 || layout[layout.size() - 2] != stage)
+                              : int(stage) == (layout.empty() ? 0 : int(layout.back()) + 1);
+        if (!follows) return false;
+        layout.push_back(stage);
+    }
+    return !layout.empty() && layout.back() == STAGE_WB;
+}
+
+// What a finished simulate() run reports
+struct SimResult {
+    uint64_t cycles = 0;
+    uint64_t retired = 0;
+    uint64_t stall_cycles = 0;   // Cycles decode was held by check_stall()
+    array<uint64_t, NUM_STALL_CAUSES> stall_causes{}; // The same cycles by cause
+    uint64_t branch_bubbles = 0; // Fetches squashed behind a branch
+    uint64_t mem_stall_cycles = 0; // Cycles the pipeline waited on MEM
+    uint64_t fetch_stall_cycles = 0; // Cycles fetch waited on an instruction cache miss
+    CacheStats l1i, l1d;
+    PredictorStats branches;
+    // Out-of-order core: cycles spent at each occupancy of each structure,
+    // empty for the in-order cores
+    array<vector<uint64_t>, NUM_WINDOWS> occupancy;
+    bool paused = false; // Stopped at a checkpoint rather than at the end
+};
+
+// Mean occupancy of a histogram of cycles per occupancy
+inline double meanOccupancy(const vector<uint64_t>& histogram) {
+    uint64_t cycles = 0, total = 0;
+    for (size_t n = 0; n < histogram.size(); n++) {
+        cycles += histogram[n];
+        total += histogram[n] * n;
+    }
+    return cycles ? double(total) / cycles : 0.0;
+}
+
+// The totals block printed at TraceLevel::Summary and above
+inline void printSummary(const SimResult& r, const PipelineConfig& config, const BranchPredictor& predictor) {
+    cout << "Cycles simulated: " << r.cycles << "\n";
+    cout << "Instructions retired: " << r.retired << "\n";
+    if (r.retired) {
+        cout << "CPI: " << fixed << setprecision(3) << (double)r.cycles / r.retired << defaultfloat << "\n";
+    }
+    if (config.layout.size() != NUM_STAGES) {
+        cout << "Pipeline: " << config.layout.size() << " stages (" << layoutName(config.layout) << ")\n";
+    }
+    if (config.issueWidth > 1) {
+        cout << "Issue width: " << config.issueWidth << " (" << config.memPorts << " memory ports, " << config.branchUnits
+             << " branch units), IPC " << fixed << setprecision(3) << (r.cycles ? (double)r.retired / r.cycles : 0.0)
+             << defaultfloat << "\n";
+    }
+    if (!r.occupancy[WINDOW_ROB].empty()) {
+        const OutOfOrderConfig& w = config.window;
+        cout << "Out-of-order window: ROB " << w.robEntries << ", issue queue " << w.iqEntries << ", load/store queue "
+             << w.lsqEntries << ", " << w.physRegs << " physical registers, IPC " << fixed << setprecision(3)
+             << (r.cycles ? (double)r.retired / r.cycles : 0.0) << defaultfloat << "\n";
+        // Eight buckets per structure, as shares of the cycles
+        for (int k = 0; k < NUM_WINDOWS; k++) {
+            const vector<uint64_t>& h = r.occupancy[k];
+            uint64_t cycles = accumulate(h.begin(), h.end(), uint64_t(0));
+            size_t size = h.size() - 1, step = max<size_t>(1, (size + 8) / 8);
+            cout << "  " << windowNames[k] << ": mean " << fixed << setprecision(1) << meanOccupancy(h) << " of " << size
+                 << ", full " << setprecision(2) << (cycles ? 100.0 * h[size] / cycles : 0.0) << "% |";
+            for (size_t from = 0; from <= size; from += step) {
+                size_t to = min(size, from + step - 1);
+                uint64_t in = accumulate(h.begin() + from, h.begin() + to + 1, uint64_t(0));
+                cout << " " << from << "-" << to << " " << setprecision(1) << (cycles ? 100.0 * in / cycles : 0.0) << "%";
+            }
+            cout << defaultfloat << "\n";
+        }
+    }
+    if (r.stall_cycles) {
+        cout << "Stall cycles: " << r.stall_cycles << " (";
+        const char* sep = "";
+        for (int c = STALL_NONE + 1; c < NUM_STALL_CAUSES; c++) {
+            if (!r.stall_causes[c]) continue;
+            cout << sep << stallCauseNames[c] << " " << r.stall_causes[c];
+            sep = ", ";
+        }
+        cout << ")\n";
+    }
+    auto cacheLine = [](const char* name, const CacheStats& c) {
+        uint64_t accesses = c.hits + c.misses;
+        cout << name << ": " << c.hits << " hits, " << c.misses << " misses (" << fixed << setprecision(2)
+             << (accesses ? 100.0 * c.misses / accesses : 0.0) << defaultfloat << "%), " << c.evictions
+             << " evictions, " << c.writebacks << " writebacks\n";
+    };
+    if (config.l1i.enabled()) cacheLine("L1I", r.l1i);
+    if (config.l1d.enabled()) cacheLine("L1D", r.l1d);
+    if (predictor.enabled()) {
+        const PredictorStats& b = r.branches;
+        cout << "Branch predictor (" << predictorNames[int(config.predictor.kind)] << "): " << b.branches
+             << " branches, " << b.mispredicts << " mispredicted (accuracy " << fixed << setprecision(2)
+             << (b.branches ? 100.0 * (b.branches - b.mispredicts) / b.branches : 100.0) << "%, MPKI "
+             << (r.retired ? 1000.0 * b.mispredicts / r.retired : 0.0) << defaultfloat << "), "
+             << b.conditionalMispredicts << " of " << b.conditional << " conditional, " << b.btbMisses << " BTB misses\n";
+        cout << "Returns: " << b.returnMispredicts << " of " << b.returns << " mispredicted, indirect jumps: "
+             << b.indirectMispredicts << " of " << b.indirect << " mispredicted\n";
+        vector<BranchSite> sites = predictor.branchSites();
+        if (!sites.empty() && sites[0].mispredicted) cout << "Most mispredicted:\n";
+        for (size_t i = 0; i < min<size_t>(sites.size(), 5) && sites[i].mispredicted; i++) {
+            cout << "  0x" << hex << sites[i].pc << dec << ": " << sites[i].mispredicted << " mispredicted, "
+                 << sites[i].correct << " correct\n";
+        }
+    }
+}
+
+// The run loop every cycle-level core shares, over the core's own steps
+// (a curiously recurring template, so the loop inlines into each core).
+// Core provides
+//   template <TraceLevel L> void step(); // Simulate one cycle
+//   bool drained() const;                 // Nothing in flight and nothing left to fetch
+//   void saveCheckpoint(const string&) const;
+// the members cycle, registers, dataMemory, pc, retired, the stall
+// counters, icache, dcache, predictor, config and tracker, and may replace
+//   uint64_t idleCycles() const;                        // Cycles ahead in which nothing can change
+//   template <TraceLevel L> void skipIdle(uint64_t n);  // Jump over n of them
+//   uint32_t archPc() const;                            // pc of the next instruction to retire
+//   void finishResult(SimResult&) const;                // Counters of its own
+template <typename Core>
+class CoreDriver {
+    string checkpoint_path;
+    uint64_t next_checkpoint = UINT64_MAX; // Cycle of the next checkpoint
+    uint64_t checkpoint_every = 0; // 0: stop after the checkpoint
+
+    Core& core() { return static_cast<Core&>(*this); }
+    const Core& core() const { return static_cast<const Core&>(*this); }
+
+protected:
+    // A core that cannot tell when it is idle ticks through every cycle
+    uint64_t idleCycles() const { return 0; }
+    template <TraceLevel L>
+    void skipIdle(uint64_t) {}
+    uint32_t archPc() const { return core().pc; }
+    void finishResult(SimResult&) const {}
+
+public:
+    // Save to path after cycle `at`; with every > 0 keep running and save
+    // again every `every` cycles, otherwise stop there
+    void setCheckpoint(const string& path, uint64_t at, uint64_t every) {
+        checkpoint_path = path;
+        checkpoint_every = every;
+        next_checkpoint = every ? core().cycle + every : at;
+    }
+
+    ArchState archState() const {
+        ArchState state;
+        state.registers = core().registers;
+        state.dataMemory = core().dataMemory;
+        state.pc = core().archPc();
+        return state;
+    }
+
+    template <TraceLevel L>
+    SimResult simulate(uint64_t cycles, DiagramWriter& writer) {
+        Core& c = core();
+        bool paused = false;
+        c.tracker.setWriter(&writer);
+
+        while (c.cycle < cycles) {
+            c.template step<L>();
+            if (c.drained()) break;
+
+            // Skip ahead to the next cycle that can change anything. Traces
+            // that print every cycle still tick through.
+            if constexpr (L < TraceLevel::Cycle) {
+                uint64_t idle = min({c.idleCycles(), cycles - c.cycle, next_checkpoint - c.cycle});
+                if (idle) c.template skipIdle<L>(idle);
+            }
+
+            if (c.cycle == next_checkpoint) {
+                c.saveCheckpoint(checkpoint_path);
+                if (!checkpoint_every) {
+                    paused = true;
+                    break;
+                }
+                next_checkpoint += checkpoint_every;
+            }
+        }
+
+        SimResult result;
+        result.cycles = c.cycle;
+        result.retired = c.retired;
+        result.stall_cycles = c.stall_cycles;
+        result.stall_causes = c.stall_causes;
+        result.branch_bubbles = c.branch_bubbles;
+        result.mem_stall_cycles = c.mem_stall_cycles;
+        result.fetch_stall_cycles = c.fetch_stall_cycles;
+        result.l1i = c.icache.stats();
+        result.l1d = c.dcache.stats();
+        result.branches = c.predictor.stats();
+        c.finishResult(result);
+        result.paused = paused;
+        if constexpr (L >= TraceLevel::Summary) printSummary(result, c.config, c.predictor);
+
+        if (paused) {
+            c.tracker.pause();
+        } else {
+            c.tracker.flush();
+        }
+        c.tracker.setWriter(nullptr);
+        return result;
+    }
+
+    // Pick the compiled-in trace level at runtime
+    SimResult simulate(uint64_t cycles, DiagramWriter& writer, TraceLevel level) {
+        switch (level) {
+            case TraceLevel::Off: return simulate<TraceLevel::Off>(cycles, writer);
+            case TraceLevel::Summary: return simulate<TraceLevel::Summary>(cycles, writer);
+            case TraceLevel::Cycle: return simulate<TraceLevel::Cycle>(cycles, writer);
+            default: return simulate<TraceLevel::Stage>(cycles, writer);
+        }
+    }
+};
+
+// The five-stage in-order pipeline. Everything that differs between the
+// forwarding and no-forwarding cores lives in HazardPolicy, which provides
+//   static constexpr const char* name;
+//   static constexpr bool forwards; // EX (and ID branches) take operands from EX/MEM and MEM/WB
+//   static int readyAfter(const ControlSignals&); // Cycles from issue until a result can be read
+//   static StallCause check_stall(const Scoreboard&, uint64_t now, const PipelineRegisters&, const DecodedInstr&,
+//                                 const PipelineConfig&, bool& is_nop, uint32_t& waits);
+// Data hazards are tested against a register scoreboard that decode
+// enters every producer into and write back takes it out of.
+// Policies are resolved at compile time, so each one gets its own fully
+// inlined cycle loop.
+template <typename HazardPolicy>
+class Processor : public CoreDriver<Processor<HazardPolicy>> {
+private:
+    friend class CoreDriver<Processor>;
+
+    const Program& program; // Shared, read-only
+    PipelineConfig config;
+    vector<uint32_t> registers; // 32 registers
+    PagedMemory dataMemory; // Sparse data memory, accessed through loadData()/storeData()
+    PipelineRegisters pipeRegs;
+    PipelineRegisters tempRegs; // Next cycle's latches, written stage by stage
+    uint32_t pc = 0;
+    uint64_t cycle = 0; // Cycles simulated so far, across checkpoints
+    bool is_stall=false;
+    bool is_nop = false;
+    uint32_t branch_pc=0;
+    bool branch_taken=false;
+    bool is_branch=false;
+    int branch_squash = 0; // Squashed fetches left before fetch follows branch_pc
+    uint32_t branch_source = 0; // pc of the branch fetch is squashed behind
+    int mem_cycles = 0; // Cycles the instruction in EX/MEM has spent in MEM
+    int mem_latency = 1; // Cycles it needs there, fixed when it arrives
+    Cache icache, dcache;
+    int fetch_wait = 0; // Cycles until the line holding pc arrives
+    bool fetch_missed = false; // pc has already been looked up and missed
+    BranchPredictor predictor;
+    bool flush_decode = false; // A branch in EX mispredicted; ID holds a wrong-path instruction
+    HotspotProfiler* profiler = nullptr; // Charged with every lost cycle while set
+    Scoreboard scoreboard; // Writes in flight between ID and WB
+    uint64_t tick = 0; // Cycles the pipeline advanced, the scoreboard's clock
+    uint64_t retired = 0; // Instructions that completed write back
+    uint64_t stall_cycles = 0;
+    array<uint64_t, NUM_STALL_CAUSES> stall_causes{};
+    uint64_t branch_bubbles = 0;
+    uint64_t mem_stall_cycles = 0;
+    uint64_t fetch_stall_cycles = 0;
+    StageTracker tracker; // In-flight rows of the pipeline diagram
+    uint64_t fetch_seq = 0; // Diagram row of the instruction at pc, 0 if none yet
+
+    // Every field a checkpoint carries, in file order. Archive is a
+    // CheckpointWriter or a CheckpointReader.
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) {
+        ar.field(p.cycle);
+        ar.field(p.pc);
+        ar.field(p.is_stall);
+        ar.field(p.is_nop);
+        ar.field(p.branch_pc);
+        ar.field(p.branch_taken);
+        ar.field(p.is_branch);
+        ar.field(p.branch_squash);
+        ar.field(p.branch_source);
+        ar.field(p.mem_cycles);
+        ar.field(p.mem_latency);
+        ar.field(p.fetch_wait);
+        ar.field(p.fetch_missed);
+        ar.field(p.flush_decode);
+        ar.field(p.retired);
+        ar.field(p.stall_cycles);
+        ar.field(p.stall_causes);
+        ar.field(p.branch_bubbles);
+        ar.field(p.mem_stall_cycles);
+        ar.field(p.fetch_stall_cycles);
+        ar.field(p.fetch_seq);
+        ar.field(p.tick);
+        ar.field(p.scoreboard);
+        ar.array(p.registers, 32);
+        ar.memory(p.dataMemory);
+        ar.field(p.pipeRegs);
+        ar.field(p.tempRegs);
+        ar.field(p.icache);
+        ar.field(p.dcache);
+        ar.field(p.predictor);
+    }
+
+    // Check for stalls as the hazard policy sees them; waits is set to the
+    // operands not ready yet
+    StallCause check_stall(PipelineRegisters& pipeRegs, uint32_t& waits) {
+        waits = 0;
+        if (!pipeRegs.if_id.valid) {
+            return STALL_NONE; // No instruction in ID
+        }
+        return HazardPolicy::check_stall(scoreboard, tick, pipeRegs, program.decoded[program.index(pipeRegs.if_id.pc)], config, is_nop, waits);
+    }
+
+    // The instruction a stall waits on: the youngest producer of an operand
+    // not ready yet, or the branch in EX for a control stall
+    uint32_t stallProducer(const PipelineRegisters& pipeRegs, StallCause cause, uint32_t waits) const {
+        if (cause == STALL_CONTROL) return pipeRegs.id_ex.pc;
+        return scoreboard.producerOf(scoreboard.youngest(waits));
+    }
+
+    // Value an instruction leaving MEM/WB writes to rd
+    static uint32_t writeBackValue(const PipelineRegisters::MEM_WB& mem_wb) {
+        return mem_wb.ctrl.memToReg ? mem_wb.mem_data : mem_wb.alu_result;
+    }
+
+    // Operand r as the forwarding muxes see it: the newest result still in
+    // EX/MEM, then MEM/WB, otherwise the value read from the register file.
+    // A load in EX/MEM has no result yet; the hazard policy stalls for it.
+    static uint32_t forward(const PipelineRegisters& pipeRegs, uint32_t r, uint32_t value) {
+        if (r == 0) return 0;
+        const PipelineRegisters::EX_MEM& ex_mem = pipeRegs.ex_mem;
+        if (ex_mem.valid && !ex_mem.stall && ex_mem.ctrl.regWrite && !ex_mem.ctrl.memRead && ex_mem.rd == r) {
+            return ex_mem.alu_result;
+        }
+        const PipelineRegisters::MEM_WB& mem_wb = pipeRegs.mem_wb;
+        if (mem_wb.valid && !mem_wb.stall && mem_wb.ctrl.regWrite && mem_wb.rd == r) {
+            return writeBackValue(mem_wb);
+        }
+        return value;
+    }
+
+    // Set where fetch goes once the branch at pc resolves. With a
+    // predictor, fetch only has to change course if it went elsewhere:
+    // everything fetched since is squashed and fetch restarts at branch_pc.
+    void resolveBranch(const DecodedInstr& d, uint32_t pc, uint32_t a, uint32_t b, uint32_t predicted) {
+        branch_taken = d.opcode != 0x63 || branchTaken(d, a, b);
+        branch_pc = branch_taken ? branchTarget(d, pc, a) : pc + 4;
+        if (predictor.enabled() && predictor.resolve(d, pc, branch_taken, branch_pc, predicted)) {
+            is_branch = true;
+            branch_squash = 1 + config.branchPenalty;
+            branch_source = pc;
+            flush_decode = config.branchStage == STAGE_EX;
+            is_stall = false; // Whatever stalled in ID is on the wrong path
+            is_nop = false;
+        }
+    }
+
+    // Instruction Fetch
+    void fetch(PipelineRegisters& pipeRegs, PipelineRegisters& tempRegs) {
+        if (is_stall) {
+            // Stall: Do not fetch a new instruction, keep tempRegs.if_id unchanged
+            if(!is_nop){
+                tempRegs.if_id = pipeRegs.if_id; // Retain the current IF/ID register content
+                return;
+            }
+        }
+        if(is_branch){
+            tempRegs.if_id.nop=true;
+        }
+        else{
+            tempRegs.if_id.nop=false;
+        }
+
+        if (program.contains(pc)) {
+            // An instruction cache miss holds fetch at pc until the line
+            // arrives. Fetches squashed behind a branch do not look up.
+            if (!is_branch && icache.enabled()) {
+                if (!fetch_missed) {
+                    fetch_wait = icache.access(pc, false);
+                    fetch_missed = fetch_wait > 0;
+                }
+                if (fetch_wait > 0) {
+                    fetch_wait--;
+                    fetch_stall_cycles++;
+                    if (profiler) profiler->charge(pc, COST_FETCH);
+                    tempRegs.if_id = PipelineRegisters::IF_ID();
+                    return;
+                }
+                fetch_missed = false;
+            }
+            tempRegs.if_id.pc = pc;
+            tempRegs.if_id.instr = program.instrMemory[program.index(pc)]; // Fetch new instruction
+            tempRegs.if_id.valid = true;
+
+            if(is_branch){
+                branch_bubbles++;
+                if (profiler) profiler->charge(branch_source, COST_BRANCH);
+                tempRegs.if_id.seq = 0;
+                // Until the branch resolves, fetch keeps refetching the same pc
+                if(--branch_squash == 0){
+                    // The squashed fetch keeps its diagram row only if we refetch the same pc
+                    if(branch_pc != pc){
+                        tracker.squash(fetch_seq);
+                        fetch_seq = 0;
+                        fetch_missed = false; // Drop a miss still pending on the wrong path
+                        fetch_wait = 0;
+                    }
+                    pc = branch_pc;
+                    is_branch = false;
+                    branch_taken = false;
+                }
+            }
+            else{
+                tempRegs.if_id.seq = fetch_seq;
+                fetch_seq = 0;
+                // Follow the predictor, or simply fall through
+                tempRegs.if_id.predicted_pc = predictor.enabled() ? predictor.predict(pc) : pc + 4;
+                pc = tempRegs.if_id.predicted_pc;
+            }
+
+        } 
+        else {
+            tempRegs.if_id.valid = false; // No more instructions to fetch
+            // A jump at the end of the program still redirects fetch
+            if(is_branch && --branch_squash == 0){
+                pc = branch_pc;
+                is_branch = false;
+                branch_taken = false;
+            }
+        }
+    }
+
+    // Instruction Decode
+    void decode(PipelineRegisters& pipeRegs, PipelineRegisters& tempRegs) {
+        if (flush_decode) {
+            flush_decode = false;
+            if (pipeRegs.if_id.valid && !pipeRegs.if_id.nop) {
+                tracker.squash(pipeRegs.if_id.seq);
+                branch_bubbles++;
+                if (profiler) profiler->charge(branch_source, COST_BRANCH);
+            }
+            tempRegs.id_ex = PipelineRegisters::ID_EX();
+            tempRegs.id_ex.valid = true;
+            tempRegs.id_ex.stall = true;
+            return;
+        }
+        if (!pipeRegs.if_id.valid) {
+            tempRegs.id_ex.valid = false;
+            return;
+        }
+        // A squashed fetch behind a branch turns into a bubble, like a stall
+        if (is_stall || pipeRegs.if_id.nop) {
+            tempRegs.id_ex = PipelineRegisters::ID_EX();
+            tempRegs.id_ex.valid = true;
+            tempRegs.id_ex.stall = true;
+            return;
+        } else {
+            tempRegs.id_ex.stall = false;
+        }
+
+        const DecodedInstr& d = program.decoded[program.index(pipeRegs.if_id.pc)];
+        tempRegs.id_ex.pc = pipeRegs.if_id.pc;
+        tempRegs.id_ex.predicted_pc = pipeRegs.if_id.predicted_pc;
+        tempRegs.id_ex.seq = pipeRegs.if_id.seq;
+        tempRegs.id_ex.opcode = d.opcode;
+        tempRegs.id_ex.rd = d.rd;
+        tempRegs.id_ex.rs1 = d.rs1;
+        tempRegs.id_ex.rs2 = d.rs2;
+        tempRegs.id_ex.imm = d.imm;
+        tempRegs.id_ex.ctrl = d.ctrl;
+
+        // Read the register file; write back has already run this cycle
+        tempRegs.id_ex.rs1_val = registers[d.rs1];
+        tempRegs.id_ex.rs2_val = registers[d.rs2];
+        scoreboard.issue(d, tempRegs.id_ex.pc, tick, tick + HazardPolicy::readyAfter(d.ctrl));
+
+        // Without a predictor, fetch squashes behind every branch until it
+        // resolves, here or in EX
+        if(tempRegs.id_ex.ctrl.branch){
+            if (!predictor.enabled()) {
+                is_branch = true;
+                branch_squash = config.branchBubbles();
+                branch_source = pipeRegs.if_id.pc;
+            }
+            if (config.branchStage == STAGE_ID) {
+                uint32_t a = tempRegs.id_ex.rs1_val, b = tempRegs.id_ex.rs2_val;
+                if constexpr (HazardPolicy::forwards) {
+                    a = forward(pipeRegs, d.rs1, a);
+                    b = forward(pipeRegs, d.rs2, b);
+                }
+                resolveBranch(d, tempRegs.id_ex.pc, a, b, tempRegs.id_ex.predicted_pc);
+            }
+        }
+        tempRegs.id_ex.valid = true;
+    }
+
+    // Execute
+    void execute(PipelineRegisters& pipeRegs, PipelineRegisters& tempRegs) {
+        if (!pipeRegs.id_ex.valid) {
+            tempRegs.ex_mem.valid = false;
+            return;
+        }
+        else if (pipeRegs.id_ex.stall) {
+            tempRegs.ex_mem.valid = true;
+            tempRegs.ex_mem.stall = true;
+            return;
+        }
+        else if(!pipeRegs.id_ex.stall){
+            tempRegs.ex_mem.stall=false;
+        }
+
+
+        const DecodedInstr& d = program.decoded[program.index(pipeRegs.id_ex.pc)];
+        uint32_t a = pipeRegs.id_ex.rs1_val, b = pipeRegs.id_ex.rs2_val;
+        if constexpr (HazardPolicy::forwards) {
+            a = forward(pipeRegs, pipeRegs.id_ex.rs1, a);
+            b = forward(pipeRegs, pipeRegs.id_ex.rs2, b);
+        }
+        if (pipeRegs.id_ex.ctrl.branch && config.branchStage == STAGE_EX) {
+            resolveBranch(d, pipeRegs.id_ex.pc, a, b, pipeRegs.id_ex.predicted_pc);
+        }
+
+        tempRegs.ex_mem.pc = pipeRegs.id_ex.pc;
+        tempRegs.ex_mem.seq = pipeRegs.id_ex.seq;
+        tempRegs.ex_mem.rd = pipeRegs.id_ex.rd;
+        tempRegs.ex_mem.rs2 = pipeRegs.id_ex.rs2;
+        tempRegs.ex_mem.rs2_val = b; // Store data
+        tempRegs.ex_mem.ctrl = pipeRegs.id_ex.ctrl;
+        tempRegs.ex_mem.alu_result = aluResult(d, pipeRegs.id_ex.pc, a, b);
+        tempRegs.ex_mem.is_zero = (tempRegs.ex_mem.alu_result == 0);
+
+        tempRegs.ex_mem.valid = true;
+    }
+
+    // Memory
+    void memory(PipelineRegisters& pipeRegs, PipelineRegisters& tempRegs) {
+        if (!pipeRegs.ex_mem.valid) {
+            tempRegs.mem_wb.valid = false;
+            return;
+        }
+        else if(pipeRegs.ex_mem.stall){
+            tempRegs.mem_wb.valid = true;
+            tempRegs.mem_wb.stall=true;
+            return;
+        }
+        else if(!pipeRegs.ex_mem.stall){
+            tempRegs.mem_wb.stall=false;
+        }
+        
+        tempRegs.mem_wb.alu_result = pipeRegs.ex_mem.alu_result;
+        tempRegs.mem_wb.rd = pipeRegs.ex_mem.rd;
+        tempRegs.mem_wb.ctrl = pipeRegs.ex_mem.ctrl;
+        tempRegs.mem_wb.pc = pipeRegs.ex_mem.pc;
+        tempRegs.mem_wb.seq = pipeRegs.ex_mem.seq;
+
+        if (pipeRegs.ex_mem.ctrl.memRead || pipeRegs.ex_mem.ctrl.memWrite) {
+            uint8_t funct3 = program.decoded[program.index(pipeRegs.ex_mem.pc)].funct3;
+            if (pipeRegs.ex_mem.ctrl.memRead) {
+                tempRegs.mem_wb.mem_data = loadData(dataMemory, pipeRegs.ex_mem.alu_result, funct3);
+            } else {
+                storeData(dataMemory, pipeRegs.ex_mem.alu_result, pipeRegs.ex_mem.rs2_val, funct3);
+            }
+        }
+        tempRegs.mem_wb.valid = true;
+    }
+
+    // Write Back
+    void writeBack(PipelineRegisters& pipeRegs) {
+        if (!pipeRegs.mem_wb.valid) {
+            return; // Nothing to write back, no need to update tempRegs.mem_wb
+        }
+        else if(pipeRegs.mem_wb.stall){
+            return;
+        }
+        retired++;
+        scoreboard.retire(program.decoded[program.index(pipeRegs.mem_wb.pc)]);
+
+        if (pipeRegs.mem_wb.ctrl.regWrite) {
+            if (pipeRegs.mem_wb.rd != 0) { // x0 is hardwired to 0
+                registers[pipeRegs.mem_wb.rd] = writeBackValue(pipeRegs.mem_wb);
+            }
+        }
+    }
+
+    // Cycles the instruction arriving in EX/MEM needs in MEM, including a
+    // data cache miss. Called once per instruction, as it looks up the cache.
+    int memoryLatency(const PipelineRegisters::EX_MEM& ex_mem) {
+        if (!ex_mem.valid || ex_mem.stall) return 1;
+        int latency = ex_mem.ctrl.memRead ? config.loadLatency : 1;
+        if (ex_mem.ctrl.memRead || ex_mem.ctrl.memWrite) {
+            latency += dcache.access(ex_mem.alu_result, ex_mem.ctrl.memWrite);
+        }
+        return latency;
+    }
+
+    // MEM is still busy: write back drains, everything before MEM holds and
+    // a bubble goes down to WB. The held ID/EX operands pick up the value
+    // written back, since MEM/WB can no longer forward it.
+    void freeze(PipelineRegisters& pipeRegs, PipelineRegisters& tempRegs) {
+        writeBack(pipeRegs);
+        tempRegs.if_id = pipeRegs.if_id;
+        tempRegs.id_ex = pipeRegs.id_ex;
+        if (tempRegs.id_ex.valid && !tempRegs.id_ex.stall) {
+            tempRegs.id_ex.rs1_val = registers[tempRegs.id_ex.rs1];
+            tempRegs.id_ex.rs2_val = registers[tempRegs.id_ex.rs2];
+        }
+        tempRegs.ex_mem = pipeRegs.ex_mem;
+        tempRegs.mem_wb = PipelineRegisters::MEM_WB();
+        tempRegs.mem_wb.valid = true;
+        tempRegs.mem_wb.stall = true;
+    }
+
+    // Cycles after this one in which nothing but the counters would change:
+    // the rest of a MEM freeze, once the bubble behind the held access has
+    // reached WB, or an instruction cache miss with nothing left in flight.
+    // Either way every latch already holds what the next cycle writes to it.
+    // MEM is frozen exactly while mem_cycles counts a held access.
+    uint64_t idleCycles() const {
+        if (mem_cycles > 0) return uint64_t(mem_latency - 1 - mem_cycles);
+        bool empty = !pipeRegs.if_id.valid && !pipeRegs.id_ex.valid && !pipeRegs.ex_mem.valid && !pipeRegs.mem_wb.valid;
+        if (empty && fetch_missed && fetch_wait > 0 && !is_branch && !flush_decode) return uint64_t(fetch_wait);
+        return 0;
+    }
+
+    // Jump over n idle cycles, counting them as if they had been simulated.
+    // The rows in flight stay in their stages until the last of them.
+    template <TraceLevel L>
+    void skipIdle(uint64_t n) {
+        if (mem_cycles > 0) {
+            mem_cycles += int(n);
+            mem_stall_cycles += n;
+            if (profiler) profiler->charge(pipeRegs.ex_mem.pc, COST_MEMORY, n);
+        } else {
+            fetch_wait -= int(n);
+            fetch_stall_cycles += n;
+            if (profiler) profiler->charge(pc, COST_FETCH, n);
+            tick += n;
+        }
+        stall_causes[STALL_NONE] += n;
+        cycle += n;
+        print_current_stages<L>(pipeRegs, int64_t(cycle - 1));
+    }
+
+    // Update pipeline registers
+    template <TraceLevel L>
+    void updatePipelineRegisters(PipelineRegisters& pipeRegs, PipelineRegisters& tempRegs) {
+        
+    
+        // Update pipeline registers
+        pipeRegs.if_id = tempRegs.if_id;
+        pipeRegs.id_ex = tempRegs.id_ex;
+        pipeRegs.ex_mem = tempRegs.ex_mem;
+        pipeRegs.mem_wb = tempRegs.mem_wb;
+    
+        TraceStream<(L >= TraceLevel::Cycle)> trace;
+        // Print post-cycle state: pc, instruction number, and tempRegs
+        trace << "Post-Cycle State:\n";
+        trace << "PC: " << program.index(pc) + 1 << "\n";
+        trace << "IF/ID: ";
+        if (tempRegs.if_id.valid) {
+            trace << (program.index(tempRegs.if_id.pc) + 1);
+                
+        } else {
+            trace << "invalid";
+        }
+        trace << "\nID/EX: ";
+        if (tempRegs.id_ex.valid) {
+            if (tempRegs.id_ex.stall) {
+                trace << "noOp";
+            } else {
+                trace << (program.index(tempRegs.id_ex.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+        trace << "\nEX/MEM: ";
+        if (tempRegs.ex_mem.valid) {
+            if (tempRegs.ex_mem.stall) {
+                trace << "noOp";
+            } else {
+                trace << (program.index(tempRegs.ex_mem.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+        trace << "\nMEM/WB: ";
+        if (tempRegs.mem_wb.valid) {
+            if (tempRegs.mem_wb.stall) {
+                trace << "noOp";
+            } else {
+                trace << (program.index(tempRegs.mem_wb.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+        trace << "\n----------------------------------------\n";
+    }
+
+    // print current stages and record stage entries for the pipeline diagram
+    template <TraceLevel L>
+    void print_current_stages(PipelineRegisters& pipeRegs, int64_t cycle){
+        TraceStream<(L >= TraceLevel::Stage)> trace;
+        // Print current stage instructions from pipeRegs (before update) and update pipeline diagram
+        trace << "Current Stage Instructions (pipeRegs):\n";
+
+        trace << "IF: ";
+        if (program.contains(pc)) {
+            if (fetch_seq == 0) {
+                fetch_seq = tracker.open(pc);
+            }
+            tracker.enter(fetch_seq, STAGE_IF, cycle);
+            trace << (program.index(pc) + 1);
+        } else {
+            trace << "invalid";
+        }
+
+        trace << "\nID: ";
+        if (pipeRegs.if_id.valid) {
+            if(pipeRegs.if_id.nop){
+                trace << "noOp";
+            }
+            else{
+                tracker.enter(pipeRegs.if_id.seq, STAGE_ID, cycle);
+                trace << (program.index(pipeRegs.if_id.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+
+        trace << "\nEX: ";
+        if (pipeRegs.id_ex.valid) {
+            if (pipeRegs.id_ex.stall) {
+                trace << "noOp";
+            } else {
+                tracker.enter(pipeRegs.id_ex.seq, STAGE_EX, cycle);
+                trace << (program.index(pipeRegs.id_ex.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+
+        trace << "\nMEM: ";
+        if (pipeRegs.ex_mem.valid) {
+            if (pipeRegs.ex_mem.stall) {
+                trace << "noOp";
+            } else {
+                tracker.enter(pipeRegs.ex_mem.seq, STAGE_MEM, cycle);
+                trace << (program.index(pipeRegs.ex_mem.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+
+        trace << "\nWB: ";
+        if (pipeRegs.mem_wb.valid) {
+            if (pipeRegs.mem_wb.stall) {
+                trace << "noOp";
+            } else {
+                tracker.enter(pipeRegs.mem_wb.seq, STAGE_WB, cycle);
+                trace << (program.index(pipeRegs.mem_wb.pc) + 1);
+            }
+        } else {
+            trace << "invalid";
+        }
+        trace << "\n";
+    }
+
+public:
+    Processor(const Program& program, const PipelineConfig& config = PipelineConfig())
+        : Processor(program, initialState(program), config) {}
+
+    // Start the pipeline empty at state.pc, e.g. after a functional fast-forward
+    Processor(const Program& program, const ArchState& state, const PipelineConfig& config = PipelineConfig())
+        : program(program), config(config), registers(state.registers), dataMemory(state.dataMemory), pc(state.pc),
+          icache(config.l1i), dcache(config.l1d), predictor(config.predictor) {}
+
+    // Save the complete simulator state: architectural state, latches,
+    // hazard flags, counters and the diagram rows still in flight
+    void saveCheckpoint(const string& path) const {
+        CheckpointWriter out;
+        out.magic();
+        out.text(HazardPolicy::name);
+        out.field(programHash(program.instrMemory));
+        out.field(uint32_t(program.instrMemory.size()));
+        checkpointFields(out, *this);
+        out.field(tracker.nextSeq());
+        out.array(tracker.inflightRecords());
+        out.save(path);
+    }
+
+    // Resume from a checkpoint taken on the same program and hazard policy.
+    // The pipeline configuration is the processor's own, so experiments
+    // can branch from one warmed checkpoint with different parameters.
+    void restoreCheckpoint(const string& path) {
+        CheckpointReader in(path);
+        in.magic();
+        string policy;
+        in.text(policy);
+        if (policy != HazardPolicy::name) {
+            throw runtime_error("checkpoint " + path + " was taken in " + policy + " mode");
+        }
+        uint64_t hash;
+        uint32_t size;
+        in.field(hash);
+        in.field(size);
+        if (hash != programHash(program.instrMemory) || size != program.instrMemory.size()) {
+            throw runtime_error("checkpoint " + path + " was taken on a different program");
+        }
+        checkpointFields(in, *this);
+        uint64_t seq;
+        vector<StageRecord> records;
+        in.field(seq);
+        in.array(records);
+        // Latched instructions and diagram rows index the program by pc
+        bool outside = (pipeRegs.if_id.valid && !program.contains(pipeRegs.if_id.pc)) ||
+                       (tempRegs.if_id.valid && !program.contains(tempRegs.if_id.pc));
+        for (const StageRecord& rec : records) outside = outside || !program.contains(rec.pc);
+        if (outside) {
+            throw runtime_error("checkpoint " + path + " holds a pc outside the program");
+        }
+        tracker.restore(records, seq);
+    }
+
+    // Charge lost cycles to the profiler, which must also be the diagram
+    // writer simulate() is given; nullptr to stop
+    void setProfiler(HotspotProfiler* p) { profiler = p; }
+
+    // Simulate one cycle
+    template <TraceLevel L>
+    void step() {
+        TraceStream<(L >= TraceLevel::Cycle)> trace;
+        TraceStream<(L >= TraceLevel::Stage)> stageTrace;
+
+        trace << "Cycle " << cycle+1 << ":\n";
+        // A multi-cycle memory access holds the whole front of the pipeline
+        if (++mem_cycles == 1) mem_latency = memoryLatency(pipeRegs.ex_mem);
+        bool frozen = mem_cycles < mem_latency;
+        if (!frozen) mem_cycles = 0;
+        mem_stall_cycles += frozen;
+
+        // Check for stall condition
+        uint32_t waits = 0;
+        StallCause cause = frozen ? STALL_NONE : check_stall(pipeRegs, waits);
+        is_stall = cause != STALL_NONE;
+        stall_cycles += is_stall;
+        stall_causes[cause]++;
+        if (profiler) {
+            if (frozen) profiler->charge(pipeRegs.ex_mem.pc, COST_MEMORY);
+            if (is_stall) profiler->charge(stallProducer(pipeRegs, cause, waits), COST_STALL);
+        }
+
+        trace << "****Stall: " << is_stall << "****\n";
+        trace << "****NOP: " << is_nop << "****\n";
+
+
+        print_current_stages<L>(pipeRegs, int64_t(cycle));
+        tracker.drain();
+        stageTrace << "branch taken ******************     "<<branch_taken<<endl;
+
+        // Execute stages in reverse order (WB first, IF last)
+        if (frozen) {
+            freeze(pipeRegs, tempRegs);
+        } else {
+            writeBack(pipeRegs);
+            memory(pipeRegs, tempRegs);
+            execute(pipeRegs, tempRegs);
+            decode(pipeRegs, tempRegs);
+            fetch(pipeRegs, tempRegs);
+            tick++;
+        }
+
+
+        // Update pipeline registers
+        updatePipelineRegisters<L>(pipeRegs, tempRegs);
+        cycle++;
+    }
+
+    bool drained() const {
+        return !pipeRegs.if_id.valid && !pipeRegs.id_ex.valid && !pipeRegs.ex_mem.valid && !pipeRegs.mem_wb.valid &&
+               !program.contains(pc);
+    }
+};
@@ -0,0 +1,497 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "isa.hpp"
+#include "checkpoint.hpp"
+
+using namespace std;
+
+enum class PredictorKind : uint8_t { None, NotTaken, BTFN, Bimodal, GShare, TAGE };
+static const char* const predictorNames[] = {"none", "nottaken", "btfn", "bimodal", "gshare", "tage"};
+
+// Which predictor fetch consults, and its table sizes. None keeps the
+// original behaviour: fetch is squashed behind every branch until it
+// resolves, with no speculation.
+struct PredictorConfig {
+    PredictorKind kind = PredictorKind::None;
+    uint32_t btbEntries = 512; // Branch target buffer, direct-mapped
+    uint32_t tableBits = 12;   // log2 of the counter table (bimodal, gshare) or of each TAGE component
+    uint32_t historyBits = 12; // Global history folded into the gshare index
+    uint32_t rasEntries = 16;  // Return-address stack, 0 to predict returns from the BTB
+    uint32_t indirectEntries = 256; // Indirect-target cache, 0 to predict other jalr from the BTB
+
+    bool enabled() const { return kind != PredictorKind::None; }
+};
+
+struct PredictorStats {
+    uint64_t branches = 0;               // Resolved branches and jumps
+    uint64_t mispredicts = 0;            // Resolved to a different next pc than fetch took
+    uint64_t conditional = 0;            // Of which conditional branches
+    uint64_t conditionalMispredicts = 0;
+    uint64_t btbMisses = 0;              // Taken branches and jumps without a BTB entry
+    uint64_t returns = 0;                // jalr that pop the return-address stack
+    uint64_t returnMispredicts = 0;
+    uint64_t indirect = 0;               // Other jalr
+    uint64_t indirectMispredicts = 0;
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& s) {
+        ar.field(s.branches); ar.field(s.mispredicts); ar.field(s.conditional);
+        ar.field(s.conditionalMispredicts); ar.field(s.btbMisses);
+        ar.field(s.returns); ar.field(s.returnMispredicts);
+        ar.field(s.indirect); ar.field(s.indirectMispredicts);
+    }
+};
+
+// Outcomes of the branch or jump at one pc
+struct BranchSite {
+    uint32_t pc = 0;
+    uint64_t correct = 0;
+    uint64_t mispredicted = 0;
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& s) { ar.field(s.pc); ar.field(s.correct); ar.field(s.mispredicted); }
+};
+
+// Link registers by the RISC-V calling convention: x1 (ra) and x5 (t0)
+inline bool isLinkRegister(uint8_t r) { return r == 1 || r == 5; }
+
+// Direction of conditional branches. predict() is asked at fetch with the
+// target the BTB knows; update() sees every resolved conditional branch in
+// program order.
+class DirectionPredictor {
+public:
+    virtual ~DirectionPredictor() {}
+    virtual bool predict(uint32_t pc, uint32_t target) = 0;
+    virtual void update(uint32_t pc, uint32_t target, bool taken) = 0;
+    virtual void save(CheckpointWriter& out) const = 0;
+    virtual void load(CheckpointReader& in) = 0;
+};
+
+// Routes save()/load() to the predictor's checkpointFields() visitor
+template <typename Derived>
+class DirectionPredictorBase : public DirectionPredictor {
+public:
+    void save(CheckpointWriter& out) const override { Derived::checkpointFields(out, static_cast<const Derived&>(*this)); }
+    void load(CheckpointReader& in) override { Derived::checkpointFields(in, static_cast<Derived&>(*this)); }
+};
+
+// Saturating two-bit counter: 0-1 predict not taken, 2-3 taken
+inline void trainCounter(uint8_t& counter, bool taken) {
+    if (taken) {
+        if (counter < 3) counter++;
+    } else if (counter > 0) {
+        counter--;
+    }
+}
+
+class NotTakenPredictor : public DirectionPredictorBase<NotTakenPredictor> {
+public:
+    bool predict(uint32_t, uint32_t) override { return false; }
+    void update(uint32_t, uint32_t, bool) override {}
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive&, Self&) {}
+};
+
+// Backward taken, forward not taken: loops close with backward branches
+class BTFNPredictor : public DirectionPredictorBase<BTFNPredictor> {
+public:
+    bool predict(uint32_t pc, uint32_t target) override { return target <= pc; }
+    void update(uint32_t, uint32_t, bool) override {}
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive&, Self&) {}
+};
+
+// One two-bit counter per pc, indexed by its low bits
+class BimodalPredictor : public DirectionPredictorBase<BimodalPredictor> {
+    vector<uint8_t> counters;
+    uint32_t mask;
+public:
+    explicit BimodalPredictor(uint32_t bits) : counters(size_t(1) << bits, 1), mask((1u << bits) - 1) {}
+    bool predict(uint32_t pc, uint32_t) override { return counters[(pc >> 2) & mask] >= 2; }
+    void update(uint32_t pc, uint32_t, bool taken) override { trainCounter(counters[(pc >> 2) & mask], taken); }
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) { ar.array(p.counters, p.counters.size()); }
+};
+
+// Two-bit counters indexed by pc xor the global branch history
+class GSharePredictor : public DirectionPredictorBase<GSharePredictor> {
+    vector<uint8_t> counters;
+    uint32_t mask;
+    uint32_t historyMask;
+    uint32_t history = 0;
+    uint32_t index(uint32_t pc) const { return ((pc >> 2) ^ (history & historyMask)) & mask; }
+public:
+    GSharePredictor(uint32_t bits, uint32_t historyBits)
+        : counters(size_t(1) << bits, 1), mask((1u << bits) - 1),
+          historyMask(historyBits >= 32 ? ~0u : (1u << historyBits) - 1) {}
+    bool predict(uint32_t pc, uint32_t) override { return counters[index(pc)] >= 2; }
+    void update(uint32_t pc, uint32_t, bool taken) override {
+        trainCounter(counters[index(pc)], taken);
+        history = history << 1 | taken;
+    }
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) {
+        ar.array(p.counters, p.counters.size());
+        ar.field(p.history);
+    }
+};
+
+// A small TAGE: a bimodal base plus four tagged components indexed with
+// geometrically longer slices of the global history. The longest matching
+// component provides the prediction; a misprediction allocates an entry in
+// a longer component.
+class TagePredictor : public DirectionPredictorBase<TagePredictor> {
+    static const int numTables = 4;
+    static constexpr int historyLengths[numTables] = {5, 12, 27, 64};
+    static const uint32_t tagBits = 9;
+
+    struct Entry {
+        int8_t counter = 0;  // -4..3, taken when >= 0
+        uint16_t tag = 0;
+        uint8_t useful = 0;  // 0..3
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& e) {
+            ar.field(e.counter); ar.field(e.tag); ar.field(e.useful);
+        }
+    };
+
+    uint32_t bits;
+    vector<uint8_t> base;
+    array<vector<Entry>, numTables> tables;
+    uint64_t history = 0;
+    uint64_t updates = 0;
+    uint32_t rng = 0x2545F491;
+
+    static uint32_t fold(uint64_t h, int length, uint32_t width) {
+        if (length < 64) h &= (uint64_t(1) << length) - 1;
+        uint32_t result = 0;
+        for (; h; h >>= width) result ^= uint32_t(h) & ((1u << width) - 1);
+        return result;
+    }
+    uint32_t index(int t, uint32_t pc) const {
+        return ((pc >> 2) ^ (pc >> (2 + bits)) ^ fold(history, historyLengths[t], bits)) & ((1u << bits) - 1);
+    }
+    // Never 0, which marks an entry nothing has allocated
+    uint16_t tag(int t, uint32_t pc) const {
+        uint32_t h = fold(history, historyLengths[t], tagBits) ^ (fold(history, historyLengths[t], tagBits - 1) << 1);
+        return uint16_t((((pc >> 2) ^ h) & ((1u << tagBits) - 1)) | (1u << tagBits));
+    }
+
+    // Longest and second-longest matching components, -1 for the base
+    pair<int, int> lookup(uint32_t pc) const {
+        int provider = -1, alt = -1;
+        for (int t = numTables - 1; t >= 0; t--) {
+            if (tables[t][index(t, pc)].tag != tag(t, pc)) continue;
+            if (provider < 0) provider = t;
+            else { alt = t; break; }
+        }
+        return {provider, alt};
+    }
+    bool predictionOf(int t, uint32_t pc) const {
+        return t < 0 ? base[(pc >> 2) & ((1u << bits) - 1)] >= 2 : tables[t][index(t, pc)].counter >= 0;
+    }
+
+public:
+    explicit TagePredictor(uint32_t bits) : bits(bits), base(size_t(1) << bits, 1) {
+        for (vector<Entry>& table : tables) table.assign(size_t(1) << bits, Entry());
+    }
+
+    bool predict(uint32_t pc, uint32_t) override { return predictionOf(lookup(pc).first, pc); }
+
+    void update(uint32_t pc, uint32_t, bool taken) override {
+        auto [provider, alt] = lookup(pc);
+        bool predicted = predictionOf(provider, pc);
+        if (provider < 0) {
+            trainCounter(base[(pc >> 2) & ((1u << bits) - 1)], taken);
+        } else {
+            Entry& e = tables[provider][index(provider, pc)];
+            if (predicted != predictionOf(alt, pc)) {
+                if (predicted == taken) e.useful = uint8_t(min(3, e.useful + 1));
+                else if (e.useful > 0) e.useful--;
+            }
+            if (taken) e.counter = int8_t(min(3, e.counter + 1));
+            else e.counter = int8_t(max(-4, e.counter - 1));
+        }
+
+        // Mispredicted: claim a free entry in a longer component, or age them
+        if (predicted != taken && provider < numTables - 1) {
+            vector<int> free;
+            for (int t = provider + 1; t < numTables; t++) {
+                if (tables[t][index(t, pc)].useful == 0) free.push_back(t);
+            }
+            if (free.empty()) {
+                for (int t = provider + 1; t < numTables; t++) tables[t][index(t, pc)].useful--;
+            } else {
+                rng ^= rng << 13;
+                rng ^= rng >> 17;
+                rng ^= rng << 5;
+                int t = free[(rng & 3) == 0 && free.size() > 1 ? 1 : 0]; // Mostly the shortest free one
+                Entry& e = tables[t][index(t, pc)];
+                e.tag = tag(t, pc);
+                e.counter = taken ? 0 : -1;
+                e.useful = 0;
+            }
+        }
+
+        // Periodically decay usefulness so stale entries can be replaced
+        if (++updates % (1u << 18) == 0) {
+            for (vector<Entry>& table : tables)
+                for (Entry& e : table) e.useful >>= 1;
+        }
+        history = history << 1 | taken;
+    }
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) {
+        ar.array(p.base, p.base.size());
+        for (auto& table : p.tables) ar.array(table, table.size());
+        ar.field(p.history);
+        ar.field(p.updates);
+        ar.field(p.rng);
+    }
+};
+
+// Circular stack of return addresses; a push onto a full stack overwrites
+// the oldest entry and popping an empty one yields nothing
+class ReturnStack {
+    vector<uint32_t> entries;
+    uint32_t top = 0;   // Next free slot
+    uint32_t depth = 0; // Valid entries
+public:
+    explicit ReturnStack(uint32_t size = 0) : entries(size, 0) {}
+    bool empty() const { return depth == 0; }
+    uint32_t capacity() const { return uint32_t(entries.size()); }
+    uint32_t peek() const { return entries[(top + entries.size() - 1) % entries.size()]; }
+    void push(uint32_t addr) {
+        if (entries.empty()) return;
+        entries[top] = addr;
+        top = uint32_t((top + 1) % entries.size());
+        depth = min<uint32_t>(depth + 1, uint32_t(entries.size()));
+    }
+    void pop() {
+        if (depth == 0) return;
+        top = uint32_t((top + entries.size() - 1) % entries.size());
+        depth--;
+    }
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& s) {
+        ar.array(s.entries, s.entries.size());
+        ar.field(s.top);
+        ar.field(s.depth);
+        if (s.depth > s.entries.size() || (s.top != 0 && s.top >= s.entries.size())) {
+            throw runtime_error("corrupt checkpoint return stack");
+        }
+    }
+};
+
+// The fetch-side predictor: a branch target buffer that recognises
+// branches and jumps by pc and supplies their target, plus a direction
+// predictor for the conditional ones. Calls and returns, told apart by
+// their link registers, go through a return-address stack and other jalr
+// through an indirect-target cache indexed by pc and the recent indirect
+// targets. Trained when branches resolve.
+class BranchPredictor {
+    enum : uint8_t { EMPTY, CONDITIONAL, JUMP, INDIRECT };
+    enum : uint8_t { PUSH = 1, POP = 2 }; // Return-stack action, pop first
+    struct BtbEntry {
+        uint32_t pc = 0;
+        uint32_t target = 0;
+        uint8_t kind = EMPTY;
+        uint8_t stack = 0;
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& e) {
+            ar.field(e.pc); ar.field(e.target); ar.field(e.kind); ar.field(e.stack);
+        }
+    };
+    struct IndirectEntry {
+        uint32_t pc = 0;
+        uint32_t target = 0;
+
+        template <typename Archive, typename Self>
+        static void checkpointFields(Archive& ar, Self& e) { ar.field(e.pc); ar.field(e.target); }
+    };
+
+    PredictorConfig config;
+    unique_ptr<DirectionPredictor> direction;
+    vector<BtbEntry> btb;
+    // Fetch pushes and pops speculatively; on a mispredict it starts again
+    // from the stack as of the resolved branches
+    ReturnStack fetchStack, resolvedStack;
+    vector<IndirectEntry> indirect;
+    uint32_t targetHistory = 0; // Recent indirect targets, folded
+    unordered_map<uint32_t, BranchSite> sites;
+    PredictorStats counters;
+
+    BtbEntry& btbEntry(uint32_t pc) { return btb[(pc >> 2) & (btb.size() - 1)]; }
+    IndirectEntry& indirectEntry(uint32_t pc) {
+        return indirect[((pc >> 2) ^ targetHistory) & (indirect.size() - 1)];
+    }
+
+    // What a jump does to the return stack, after the RISC-V hints: a link
+    // destination pushes, a link source pops, and jalr ra, ra is a call
+    uint8_t stackAction(const DecodedInstr& d) const {
+        if (config.rasEntries == 0 || (d.opcode != 0x6F && d.opcode != 0x67)) return 0;
+        uint8_t action = isLinkRegister(d.rd) ? PUSH : 0;
+        if (d.opcode == 0x67 && isLinkRegister(d.rs1) && !(isLinkRegister(d.rd) && d.rd == d.rs1)) action |= POP;
+        return action;
+    }
+
+public:
+    explicit BranchPredictor(const PredictorConfig& config) : config(config) {
+        switch (config.kind) {
+            case PredictorKind::None: return;
+            case PredictorKind::NotTaken: direction = make_unique<NotTakenPredictor>(); break;
+            case PredictorKind::BTFN: direction = make_unique<BTFNPredictor>(); break;
+            case PredictorKind::Bimodal: direction = make_unique<BimodalPredictor>(config.tableBits); break;
+            case PredictorKind::GShare: direction = make_unique<GSharePredictor>(config.tableBits, config.historyBits); break;
+            case PredictorKind::TAGE: direction = make_unique<TagePredictor>(config.tableBits); break;
+        }
+        btb.assign(config.btbEntries, BtbEntry());
+        fetchStack = resolvedStack = ReturnStack(config.rasEntries);
+        indirect.assign(config.indirectEntries, IndirectEntry());
+    }
+
+    bool enabled() const { return config.enabled(); }
+    const PredictorStats& stats() const { return counters; }
+
+    // Per-pc outcomes, most mispredicted first
+    vector<BranchSite> branchSites() const {
+        vector<BranchSite> result;
+        for (const auto& [pc, site] : sites) result.push_back(site);
+        sort(result.begin(), result.end(), [](const BranchSite& a, const BranchSite& b) {
+            return a.mispredicted != b.mispredicted ? a.mispredicted > b.mispredicted : a.pc < b.pc;
+        });
+        return result;
+    }
+
+    // Where fetch goes after the instruction at pc
+    uint32_t predict(uint32_t pc) {
+        BtbEntry& e = btbEntry(pc);
+        if (e.kind == EMPTY || e.pc != pc) return pc + 4;
+        if (e.kind == CONDITIONAL && !direction->predict(pc, e.target)) return pc + 4;
+        uint32_t target = e.target;
+        if (e.stack & POP) {
+            if (!fetchStack.empty()) target = fetchStack.peek();
+            fetchStack.pop();
+        } else if (e.kind == INDIRECT && !indirect.empty()) {
+            IndirectEntry& i = indirectEntry(pc);
+            if (i.pc == pc) target = i.target;
+        }
+        if (e.stack & PUSH) fetchStack.push(pc + 4);
+        return target;
+    }
+
+    // The branch or jump d at pc resolved to next; fetch had gone to
+    // predicted. Trains the predictor and returns whether it was wrong. A
+    // wrong prediction also puts fetch's return stack back as of the
+    // resolved branches, unless the core repaired it already (repair false).
+    bool resolve(const DecodedInstr& d, uint32_t pc, bool taken, uint32_t next, uint32_t predicted, bool repair = true) {
+        bool conditional = d.opcode == 0x63;
+        bool wrong = next != predicted;
+        uint8_t action = stackAction(d);
+        counters.branches++;
+        counters.mispredicts += wrong;
+        if (conditional) {
+            counters.conditional++;
+            counters.conditionalMispredicts += wrong;
+        } else if (action & POP) {
+            counters.returns++;
+            counters.returnMispredicts += wrong;
+        } else if (d.opcode == 0x67) {
+            counters.indirect++;
+            counters.indirectMispredicts += wrong;
+        }
+        BranchSite& site = sites[pc];
+        site.pc = pc;
+        (wrong ? site.mispredicted : site.correct)++;
+
+        BtbEntry& e = btbEntry(pc);
+        if (taken) {
+            if (e.kind == EMPTY || e.pc != pc) counters.btbMisses++;
+            e.pc = pc;
+            e.target = next;
+            e.kind = conditional ? CONDITIONAL : d.opcode == 0x67 ? INDIRECT : JUMP;
+            e.stack = action;
+        }
+        if (conditional) direction->update(pc, branchTarget(d, pc, 0), taken);
+        if (d.opcode == 0x67 && !(action & POP) && !indirect.empty()) {
+            indirectEntry(pc) = {pc, next};
+            targetHistory = (targetHistory << 2) ^ (next >> 2);
+        }
+        if (action & POP) resolvedStack.pop();
+        if (action & PUSH) resolvedStack.push(pc + 4);
+        if (wrong && repair) fetchStack = resolvedStack;
+        return wrong;
+    }
+
+    // Fetch's return stack, for a core that resolves branches out of order:
+    // it keeps the stack as fetch left it behind each branch and puts it
+    // back when that branch turns out mispredicted
+    const ReturnStack& returnStack() const { return fetchStack; }
+    void restoreReturnStack(const ReturnStack& stack) { fetchStack = stack; }
+
+    // Checkpoint contents, in a section of their own: restoring into a
+    // different predictor skips them and starts cold
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) {
+        ar.section([&] {
+            string shape = string(predictorNames[int(p.config.kind)]) + "/" + to_string(p.config.btbEntries) + "/" +
+                           to_string(p.config.tableBits) + "/" + to_string(p.config.historyBits) + "/" +
+                           to_string(p.config.rasEntries) + "/" + to_string(p.config.indirectEntries);
+            string saved = shape;
+            ar.text(saved);
+            if (saved != shape) {
+                ar.skipSection();
+                return;
+            }
+            ar.field(p.counters);
+            if (!p.config.enabled()) return;
+            ar.array(p.btb, p.btb.size());
+            ar.field(p.fetchStack);
+            ar.field(p.resolvedStack);
+            ar.array(p.indirect, p.indirect.size());
+            ar.field(p.targetHistory);
+            vector<BranchSite> sites = p.branchSites();
+            ar.array(sites);
+            if constexpr (!is_const<Self>::value) {
+                p.sites.clear();
+                for (const BranchSite& site : sites) p.sites[site.pc] = site;
+            }
+            if constexpr (is_const<Self>::value) {
+                p.direction->save(ar);
+            } else {
+                p.direction->load(ar);
+            }
+        });
+    }
+};
+
+// Parse "gshare", "tage,bits=10" or "bimodal,btb=1024,bits=14"; history= sets the gshare history length,
+// ras= the return-stack depth and indirect= the indirect-target cache entries
+inline bool parsePredictorSpec(const string& text, PredictorConfig& config) {
+    config = PredictorConfig();
+    stringstream ss(text);
+    string item;
+    if (!getline(ss, item, ',')) return false;
+    auto name = find(begin(predictorNames), end(predictorNames), item);
+    if (name == end(predictorNames)) return false;
+    config.kind = PredictorKind(name - begin(predictorNames));
+    while (getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) return false;
+        string key = item.substr(0, eq), value = item.substr(eq + 1);
+        if (value.empty() || value.find_first_not_of("0123456789") != string::npos || value.size() > 9) return false;
+        uint32_t n = uint32_t(stoul(value));
+        if (key == "btb") config.btbEntries = n;
+        else if (key == "bits") config.tableBits = n;
+        else if (key == "history") config.historyBits = n;
+        else if (key == "ras") config.rasEntries = n;
+        else if (key == "indirect") config.indirectEntries = n;
+        else return false;
+    }
+    return config.btbEntries && !(config.btbEntries & (config.btbEntries - 1)) &&
+           !(config.indirectEntries & (config.indirectEntries - 1)) && config.rasEntries <= 1024 && config.tableBits >= 1 &&
+           config.tableBits <= 24 && config.historyBits <= 32;
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "trace.hpp"
+#include "program.hpp"
+
+using namespace std;
+
+// Pipeline cycles an instruction is charged for holding others up
+enum CostKind {
+    COST_STALL = 0, // Decode held waiting on this instruction's result (or on this branch)
+    COST_MEMORY,    // The pipeline froze while this instruction was in MEM
+    COST_FETCH,     // Fetch waited on an instruction cache miss at this pc
+    COST_BRANCH,    // Fetches squashed behind this branch
+    NUM_COSTS
+};
+
+static const char* const costNames[NUM_COSTS] = {"stall", "memory", "fetch", "branch"};
+
+// What the profile accumulated for one pc, or for a block or function of them
+struct PcCost {
+    uint64_t executed = 0; // Reached WB
+    uint64_t squashed = 0; // Fetched on a wrong path
+    array<uint64_t, NUM_STAGES> resident{}; // Cycles spent in each stage
+    array<uint64_t, NUM_COSTS> caused{};
+
+    uint64_t residentCycles() const { return accumulate(resident.begin(), resident.end(), uint64_t(0)); }
+    uint64_t causedCycles() const { return accumulate(caused.begin(), caused.end(), uint64_t(0)); }
+
+    PcCost& operator+=(const PcCost& other) {
+        executed += other.executed;
+        squashed += other.squashed;
+        for (int s = 0; s < NUM_STAGES; s++) resident[s] += other.resident[s];
+        for (int c = 0; c < NUM_COSTS; c++) caused[c] += other.caused[c];
+        return *this;
+    }
+};
+
+// Per-pc hotspot profile. It sits in front of the diagram writer, so it
+// sees every row as it leaves the pipeline and takes the cycles spent in
+// each stage from it; the processor charges stall, memory, fetch and
+// branch cycles to the instruction responsible through charge(). Results
+// roll up to basic blocks and to functions by symbol, and are written as
+// folded stacks for flamegraph tools and as a top-N table.
+class HotspotProfiler : public DiagramWriter {
+    const Program& program;
+    DiagramWriter& next;
+    string fallback;      // Function name for code below the first symbol
+    vector<PcCost> costs; // Indexed by program.index(pc)
+    set<uint32_t> leaders; // First pc of every basic block
+
+public:
+    HotspotProfiler(const Program& program, DiagramWriter& next, string fallback = "[program]")
+        : program(program), next(next), fallback(move(fallback)), costs(program.instrMemory.size()) {
+        // Blocks start at the entry, at symbols, at branch and jump targets
+        // and after every branch or jump
+        leaders.insert(program.base);
+        leaders.insert(program.entry);
+        for (const auto& symbol : program.symbols) leaders.insert(symbol.first);
+        for (size_t i = 0; i < program.decoded.size(); i++) {
+            const DecodedInstr& d = program.decoded[i];
+            uint32_t pc = program.base + uint32_t(i * 4);
+            if (d.opcode == 0x63 || d.opcode == 0x6F) leaders.insert(branchTarget(d, pc, 0));
+            if (d.opcode == 0x63 || d.opcode == 0x6F || d.opcode == 0x67) leaders.insert(pc + 4);
+        }
+    }
+
+    void charge(uint32_t pc, CostKind kind, uint64_t cycles = 1) {
+        if (program.contains(pc)) costs[program.index(pc)].caused[kind] += cycles;
+    }
+
+    void write(const StageRecord& rec) override {
+        if (program.contains(rec.pc)) {
+            PcCost& cost = costs[program.index(rec.pc)];
+            for (int s = 0; s < NUM_STAGES; s++) {
+                if (rec.enter[s] < 0) continue;
+                int64_t leave = rec.last + 1;
+                for (int later = s + 1; later < NUM_STAGES; later++) {
+                    if (rec.enter[later] >= 0) {
+                        leave = rec.enter[later];
+                        break;
+                    }
+                }
+                cost.resident[s] += uint64_t(leave - rec.enter[s]);
+            }
+            if (rec.squashed) cost.squashed++;
+            else if (rec.enter[STAGE_WB] >= 0) cost.executed++;
+        }
+        next.write(rec);
+    }
+
+    void finish() override { next.finish(); }
+
+    uint32_t blockOf(uint32_t pc) const { return *prev(leaders.upper_bound(pc)); }
+
+    string functionOf(uint32_t pc) const {
+        auto it = program.symbols.upper_bound(pc);
+        return it == program.symbols.begin() ? fallback : prev(it)->second;
+    }
+
+    // One line per pc and stage it spent cycles in:
+    // "function;block 0x..;0x.. instruction;STAGE cycles"
+    void writeFolded(ostream& out) const {
+        for (size_t i = 0; i < costs.size(); i++) {
+            uint32_t pc = program.base + uint32_t(i * 4);
+            for (int s = 0; s < NUM_STAGES; s++) {
+                if (!costs[i].resident[s]) continue;
+                out << functionOf(pc) << ";block 0x" << hex << blockOf(pc) << ";0x" << pc << dec << " "
+                    << program.instructions[i] << ";" << stageNames[s] << " " << costs[i].resident[s] << "\n";
+            }
+        }
+    }
+
+    // The top pcs and blocks by cost, the cycles resident in the pipeline
+    // plus the cycles caused, and every function
+    void writeTable(ostream& out, size_t top) const {
+        auto header = [&](const string& title, const string& what) {
+            out << title << "\n" << setw(10) << "cost" << setw(10) << "resident";
+            for (const char* stage : stageNames) out << setw(8) << stage;
+            for (const char* cost : costNames) out << setw(8) << cost;
+            out << setw(10) << "executed" << "  " << what << "\n";
+        };
+        auto row = [&](const PcCost& cost) {
+            out << setw(10) << cost.residentCycles() + cost.causedCycles() << setw(10) << cost.residentCycles();
+            for (uint64_t cycles : cost.resident) out << setw(8) << cycles;
+            for (uint64_t cycles : cost.caused) out << setw(8) << cycles;
+            out << setw(10) << cost.executed << "  ";
+        };
+        auto heaviest = [](const auto& totals, size_t limit) {
+            vector<pair<uint64_t, typename decay_t<decltype(totals)>::key_type>> order;
+            for (const auto& [key, cost] : totals) order.emplace_back(cost.residentCycles() + cost.causedCycles(), key);
+            sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+            if (order.size() > limit) order.resize(limit);
+            return order;
+        };
+
+        map<uint32_t, PcCost> pcs, blocks;
+        map<string, PcCost> functions;
+        for (size_t i = 0; i < costs.size(); i++) {
+            const PcCost& cost = costs[i];
+            if (!cost.residentCycles() && !cost.causedCycles()) continue;
+            uint32_t pc = program.base + uint32_t(i * 4);
+            pcs[pc] = cost;
+            blocks[blockOf(pc)] += cost;
+            functions[functionOf(pc)] += cost;
+        }
+
+        header("Top " + to_string(top) + " instructions", "pc  function  instruction");
+        for (const auto& [weight, pc] : heaviest(pcs, top)) {
+            row(pcs[pc]);
+            out << "0x" << hex << pc << dec << "  " << functionOf(pc) << "  " << program.instructions[program.index(pc)] << "\n";
+        }
+        out << "\n";
+        header("Top " + to_string(top) + " basic blocks", "block  function");
+        for (const auto& [weight, block] : heaviest(blocks, top)) {
+            row(blocks[block]);
+            out << "0x" << hex << block << dec << "  " << functionOf(block) << "\n";
+        }
+        out << "\n";
+        header("Functions", "function");
+        for (const auto& [weight, name] : heaviest(functions, functions.size())) {
+            row(functions[name]);
+            out << name << "\n";
+        }
+    }
+
+    // Write <prefix>.folded and <prefix>.top.txt
+    void writeFiles(const string& prefix, size_t top) const {
+        ofstream folded(prefix + ".folded");
+        ofstream table(prefix + ".top.txt");
+        if (!folded.is_open() || !table.is_open()) {
+            throw runtime_error("Error opening " + prefix + ".folded / .top.txt");
+        }
+        writeFolded(folded);
+        writeTable(table, top);
+    }
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "isa.hpp"
+#include "elf.hpp"
+
+using namespace std;
+
+// A loaded program. It is read-only once loaded, so any number of
+// processors (or both hazard policies) can share one instance.
+struct Program {
+    uint32_t base = 0; // Address of instrMemory[0]
+    uint32_t entry = 0; // Where execution starts
+    vector<uint32_t> instrMemory; // Instruction memory
+    vector<string_view> instructions; // Instruction strings for display, into textStorage
+    shared_ptr<const void> textStorage; // Mapped listing or disassembly buffer behind instructions
+    vector<DecodedInstr> decoded; // Predecoded instrMemory, indexed by index(pc)
+    vector<DataSegment> data; // Initial data memory contents
+    map<uint32_t, string> symbols; // Symbol names by address, from ELF or listing annotations
+
+    bool contains(uint32_t pc) const { return pc - base < instrMemory.size() * 4; }
+    size_t index(uint32_t pc) const { return (pc - base) / 4; }
+    uint32_t end() const { return base + uint32_t(instrMemory.size() * 4); }
+
+    // "name" or "name+0x1c" for the closest symbol at or below pc
+    string symbolFor(uint32_t pc) const {
+        auto it = symbols.upper_bound(pc);
+        if (it == symbols.begin()) return "";
+        --it;
+        if (it->first == pc) return it->second;
+        stringstream ss;
+        ss << it->second << "+0x" << hex << (pc - it->first);
+        return ss.str();
+    }
+};
+
+// Build a program from a statically linked RV32 executable. The
+// disassembly of every word goes into one buffer that instructions views.
+inline Program loadElf(const uint8_t* p, size_t size, const string& filename) {
+    ElfImage image = parseElf(p, size, filename);
+    Program program;
+    program.base = image.textBase;
+    program.entry = image.entry;
+    program.instrMemory = move(image.text);
+    program.decoded = predecodeProgram(program.instrMemory);
+    size_t count = program.instrMemory.size();
+    auto text = make_shared<string>(count * maxDisassemblyLength, '\0');
+    vector<size_t> ends(count);
+    char* out = text->data();
+    for (size_t i = 0; i < count; i++) {
+        out = disassembleTo(out, program.instrMemory[i], program.decoded[i]);
+        ends[i] = size_t(out - text->data());
+    }
+    text->resize(ends.empty() ? 0 : ends.back());
+    program.instructions.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        size_t begin = i ? ends[i - 1] : 0;
+        program.instructions.emplace_back(text->data() + begin, ends[i] - begin);
+    }
+    program.textStorage = move(text);
+    program.data = move(image.data);
+    program.symbols = move(image.symbols);
+    return program;
+}
+
+inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Listings name branch and jump targets objdump-style, as in
+// "bne x5 x0 -52 <bubsort>" or "<sort+0x1c>": each such annotation puts the
+// name at the target less the offset. Other instructions (an auipc of an
+// unresolved call, say) carry relocation names and are ignored.
+inline void listingSymbols(Program& program) {
+    for (size_t i = 0; i < program.instructions.size(); i++) {
+        string_view text = program.instructions[i];
+        uint8_t opcode = program.decoded[i].opcode;
+        if ((opcode != 0x63 && opcode != 0x6F) || text.empty() || text.back() != '>') continue;
+        size_t open = text.rfind('<');
+        if (open == string_view::npos || open + 2 >= text.size()) continue;
+        string_view name = text.substr(open + 1, text.size() - open - 2);
+        uint32_t offset = 0;
+        size_t plus = name.find("+0x");
+        if (plus != string_view::npos) {
+            for (char c : name.substr(plus + 3)) {
+                if (hexDigit(c) < 0) break;
+                offset = offset << 4 | uint32_t(hexDigit(c));
+            }
+            name = name.substr(0, plus);
+        }
+        if (name.empty()) continue;
+        uint32_t pc = program.base + uint32_t(i * 4);
+        program.symbols.emplace(branchTarget(program.decoded[i], pc, 0) - offset, string(name));
+    }
+}
+
+// Parse an "address:machine_code instruction_text" listing in place. The
+// arrays are sized from a newline count first, and the instruction text
+// stays in the mapping, which the program keeps alive.
+inline Program loadListing(shared_ptr<MappedFile> mapped, const string& filename) {
+    Program program;
+    const char* p = reinterpret_cast<const char*>(mapped->data());
+    const char* end = p + mapped->size();
+    size_t lines = 0;
+    for (const char* q = p; q < end && (q = static_cast<const char*>(memchr(q, '\n', end - q))); q++) lines++;
+    lines++;
+    program.instrMemory.reserve(lines);
+    program.instructions.reserve(lines);
+
+    for (size_t lineNo = 1; p < end; lineNo++) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        const char* last = eol;
+        if (last > p && last[-1] == '\r') last--;
+        const char* q = p;
+        p = eol + 1;
+        if (q == last) continue; // Blank line
+
+        auto fail = [&] { return runtime_error(filename + ":" + to_string(lineNo) + ": expected \"address:machine_code instruction\""); };
+        q = static_cast<const char*>(memchr(q, ':', last - q));
+        if (!q) throw fail();
+        q++;
+        while (q < last && (*q == ' ' || *q == '\t')) q++;
+        if (last - q > 2 && q[0] == '0' && (q[1] == 'x' || q[1] == 'X')) q += 2;
+        uint64_t word = 0;
+        const char* digits = q;
+        for (int d; q < last && (d = hexDigit(*q)) >= 0; q++) word = word << 4 | uint32_t(d);
+        if (q == digits || q - digits > 8 || (q < last && *q != ' ' && *q != '\t')) throw fail();
+        while (q < last && (*q == ' ' || *q == '\t')) q++;
+        program.instrMemory.push_back(uint32_t(word));
+        program.instructions.emplace_back(q, size_t(last - q));
+    }
+    program.decoded = predecodeProgram(program.instrMemory);
+    listingSymbols(program);
+    program.textStorage = move(mapped);
+    return program;
+}
+
+// Load an RV32 ELF executable or an "address:machine_code instruction_text" listing
+inline Program loadProgram(const string& filename) {
+    auto mapped = make_shared<MappedFile>(filename);
+    if (isElf(mapped->data(), mapped->size())) {
+        return loadElf(mapped->data(), mapped->size(), filename);
+    }
+    return loadListing(move(mapped), filename);
+}
+
+// Write words as an "address:machine_code instruction" listing
+inline void writeListing(const string& path, const vector<uint32_t>& words) {
+    ofstream out(path);
+    if (!out.is_open()) throw runtime_error("Error opening " + path);
+    char text[maxDisassemblyLength];
+    for (size_t i = 0; i < words.size(); i++) {
+        char* end = disassembleTo(text, words[i], predecode(words[i]));
+        out << hex << i * 4 << ":" << setw(8) << setfill('0') << words[i] << dec << " " << string(text, end) << "\n";
+    }
+}
+
+// Architectural state: what survives between instructions, independent of
+// how (or whether) a pipeline is modelled
+struct ArchState {
+    vector<uint32_t> registers = vector<uint32_t>(32, 0);
+    PagedMemory dataMemory; // Sparse, the whole 32-bit address space
+    uint32_t pc = 0;
+};
+
+// Initial stack pointer: the top of the lower half of the address space,
+// well clear of the text and data of listings and linked executables
+static const uint32_t stackTop = 0x80000000u;
+
+// State at the start of a run. The listings are bare functions ending in
+// "jalr x0 x1 0", so ra points just past the program and the final return
+// ends the run; sp starts at stackTop. Initialised data sections are
+// copied in; everything else, .bss included, reads as zero.
+inline ArchState initialState(const Program& program) {
+    ArchState state;
+    for (const DataSegment& segment : program.data) {
+        state.dataMemory.write(segment.addr, segment.bytes.data(), segment.bytes.size());
+    }
+    state.registers[1] = program.end();
+    state.registers[2] = stackTop;
+    state.pc = program.entry;
+    return state;
+}
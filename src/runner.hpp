@@ -0,0 +1,184 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "trace.hpp"
+#include "tracefile.hpp"
+#include "program.hpp"
+#include "forwarding.hpp"
+#include "noforwarding.hpp"
+#include "functional.hpp"
+#include "slotpipeline.hpp"
+#include "outoforder.hpp"
+
+using namespace std;
+
+// Everything one simulation run needs besides the program
+struct RunOptions {
+    ArchState start;              // State the pipeline starts from
+    PipelineConfig config;
+    uint64_t cycles = 0;          // Cycle budget, counted from cycle 0
+    TraceLevel level = TraceLevel::Off;
+    string format = "text";
+    string path;                  // Diagram output, empty to discard it
+    string restorePath;           // Resume from this checkpoint instead of start
+    string checkpointPath;        // Where checkpoints go, empty for none
+    uint64_t checkpointAt = 0;    // Save and stop after this cycle
+    uint64_t checkpointEvery = 0; // Or save every N cycles and keep going
+    string profilePath;           // Hotspot profile prefix, empty for none
+    size_t profileTop = 20;       // Rows in the profile's top-N tables
+    string profileFallback;       // Function name for code without a symbol
+};
+
+// Run one core over a shared program and write its diagram to options.path
+template <typename Core>
+SimResult runCore(const Program& program, const RunOptions& options) {
+    Core processor(program, options.start, options.config);
+    if (!options.restorePath.empty()) {
+        processor.restoreCheckpoint(options.restorePath);
+    }
+    if (!options.checkpointPath.empty()) {
+        processor.setCheckpoint(options.checkpointPath, options.checkpointAt, options.checkpointEvery);
+    }
+    // With a profile, every row passes through the profiler on its way to
+    // the diagram
+    auto simulate = [&](DiagramWriter& writer) {
+        if (options.profilePath.empty()) return processor.simulate(options.cycles, writer, options.level);
+        HotspotProfiler profiler(program, writer, options.profileFallback);
+        processor.setProfiler(&profiler);
+        SimResult result = processor.simulate(options.cycles, profiler, options.level);
+        processor.setProfiler(nullptr);
+        profiler.writeFiles(options.profilePath, options.profileTop);
+        return result;
+    };
+    if (options.path.empty()) {
+        NullDiagramWriter writer;
+        return simulate(writer);
+    }
+    if (options.format == "binary") {
+        FILE* outFile = fopen(options.path.c_str(), "wb");
+        if (!outFile) {
+            throw runtime_error("Error opening " + options.path);
+        }
+        BinaryTraceWriter writer(outFile, program.instructions, program.base, options.config.issueWidth > 1);
+        SimResult result = simulate(writer);
+        fclose(outFile);
+        return result;
+    }
+    ofstream outFile(options.path);
+    if (!outFile.is_open()) {
+        throw runtime_error("Error opening " + options.path);
+    }
+    TextDiagramWriter writer(outFile, program.instructions, program.base, options.config.issueWidth > 1);
+    SimResult result = simulate(writer);
+    outFile.close();
+    return result;
+}
+
+// Run one hazard policy: on the five-stage Processor, or on SlotPipeline
+// for wider issue or another stage layout
+template <typename Policy>
+SimResult runMode(const Program& program, const RunOptions& options) {
+    if (!options.config.classic()) return runCore<SlotPipeline<Policy>>(program, options);
+    return runCore<Processor<Policy>>(program, options);
+}
+
+// Simulation modes selectable at runtime, one per compiled-in hazard
+// policy plus the out-of-order core
+struct ModeEntry {
+    const char* name;
+    SimResult (*run)(const Program&, const RunOptions&);
+    bool inOrder; // Selected by "both"
+};
+
+inline const vector<ModeEntry>& allModes() {
+    static const vector<ModeEntry> modes = {
+        {ForwardingPolicy::name, runMode<ForwardingPolicy>, true},
+        {NoForwardingPolicy::name, runMode<NoForwardingPolicy>, true},
+        {OutOfOrderProcessor::name, runCore<OutOfOrderProcessor>, false},
+    };
+    return modes;
+}
+
+inline const ModeEntry* findMode(const string& name) {
+    for (const ModeEntry& m : allModes()) {
+        if (name == m.name) return &m;
+    }
+    return nullptr;
+}
+
+// Parse "both" (the two in-order policies), "all" or a comma-separated
+// list of mode names
+inline bool parseModeList(const string& text, vector<ModeEntry>& modes) {
+    modes.clear();
+    if (text == "both" || text == "all") {
+        for (const ModeEntry& m : allModes()) {
+            if (m.inOrder || text == "all") modes.push_back(m);
+        }
+        return true;
+    }
+    stringstream ss(text);
+    string name;
+    while (getline(ss, name, ',')) {
+        const ModeEntry* mode = findMode(name);
+        if (!mode) return false;
+        modes.push_back(*mode);
+    }
+    return !modes.empty();
+}
+
+inline bool parseBranchStage(const string& text, Stage& stage) {
+    if (text == "id" || text == "ID") stage = STAGE_ID;
+    else if (text == "ex" || text == "EX") stage = STAGE_EX;
+    else return false;
+    return true;
+}
+
+// Parse "mem=M,branch=B": memory ports and branch units per cycle
+inline bool parsePortSpec(const string& text, PipelineConfig& config) {
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) return false;
+        string key = item.substr(0, eq), value = item.substr(eq + 1);
+        if (value.empty() || value.size() > 2 || value.find_first_not_of("0123456789") != string::npos) return false;
+        int n = stoi(value);
+        if (n < 1) return false;
+        if (key == "mem") config.memPorts = n;
+        else if (key == "branch") config.branchUnits = n;
+        else return false;
+    }
+    return true;
+}
+
+inline void addResult(SimResult& total, const SimResult& r) {
+    total.cycles += r.cycles;
+    total.retired += r.retired;
+    total.stall_cycles += r.stall_cycles;
+    for (int c = 0; c < NUM_STALL_CAUSES; c++) total.stall_causes[c] += r.stall_causes[c];
+    total.branch_bubbles += r.branch_bubbles;
+    total.mem_stall_cycles += r.mem_stall_cycles;
+    total.fetch_stall_cycles += r.fetch_stall_cycles;
+    for (auto [sum, part] : {pair{&total.l1i, &r.l1i}, pair{&total.l1d, &r.l1d}}) {
+        sum->hits += part->hits;
+        sum->misses += part->misses;
+        sum->evictions += part->evictions;
+        sum->writebacks += part->writebacks;
+    }
+    total.branches.branches += r.branches.branches;
+    total.branches.mispredicts += r.branches.mispredicts;
+    total.branches.conditional += r.branches.conditional;
+    total.branches.conditionalMispredicts += r.branches.conditionalMispredicts;
+    total.branches.btbMisses += r.branches.btbMisses;
+    total.branches.returns += r.branches.returns;
+    total.branches.returnMispredicts += r.branches.returnMispredicts;
+    total.branches.indirect += r.branches.indirect;
+    total.branches.indirectMispredicts += r.branches.indirectMispredicts;
+    for (int k = 0; k < NUM_WINDOWS; k++) {
+        if (total.occupancy[k].size() < r.occupancy[k].size()) total.occupancy[k].resize(r.occupancy[k].size());
+        for (size_t n = 0; n < r.occupancy[k].size(); n++) total.occupancy[k][n] += r.occupancy[k][n];
+    }
+}
+
+inline double cpi(const SimResult& result) {
+    return result.retired ? (double)result.cycles / result.retired : 0.0;
+}
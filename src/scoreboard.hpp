@@ -0,0 +1,81 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "isa.hpp"
+
+using namespace std;
+
+// Register scoreboard: which registers have a write in flight, and from
+// which cycle the newest of those writes can be read. Producers are entered
+// as they issue, with a ready cycle that comes from the latency of the unit
+// computing their result, and leave as they write back; deciding whether a
+// set of source registers can be read is then a mask test rather than a
+// comparison against every latch holding an older instruction.
+//
+// Cycles are whatever clock the core advances it by. Processor counts the
+// cycles its pipeline moved: a MEM freeze holds every producer equally, so
+// a miss lengthens no ready cycle relative to the others.
+class Scoreboard {
+    uint32_t pending = 0;            // Bit r: a write to r is in flight
+    array<uint8_t, 32> writes{};     // Writes to r in flight
+    array<uint64_t, 32> ready{};     // Cycle the newest write to r can be read from
+    array<uint64_t, 32> issued{};    // Cycle the newest write to r issued
+    array<uint32_t, 32> producer{};  // pc of the newest write to r
+
+public:
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& s) {
+        ar.field(s.pending);
+        ar.field(s.writes);
+        ar.field(s.ready);
+        ar.field(s.issued);
+        ar.field(s.producer);
+    }
+
+    // The registers d reads, as a mask; x0 is never waited on
+    static uint32_t sources(const DecodedInstr& d) {
+        uint32_t mask = (d.uses_rs1 ? 1u << d.rs1 : 0) | (d.uses_rs2 ? 1u << d.rs2 : 0);
+        return mask & ~1u;
+    }
+
+    // Registers with a write in flight
+    uint32_t inFlight() const { return pending; }
+
+    // d, at pc, issues at cycle now; what it writes can be read from readyAt
+    void issue(const DecodedInstr& d, uint32_t pc, uint64_t now, uint64_t readyAt = 0) {
+        if (!d.ctrl.regWrite || d.rd == 0) return;
+        pending |= 1u << d.rd;
+        writes[d.rd]++;
+        ready[d.rd] = readyAt;
+        issued[d.rd] = now;
+        producer[d.rd] = pc;
+    }
+
+    // d wrote back, or was squashed after issuing
+    void retire(const DecodedInstr& d) {
+        if (!d.ctrl.regWrite || d.rd == 0) return;
+        if (--writes[d.rd] == 0) pending &= ~(1u << d.rd);
+    }
+
+    // The registers of mask that cannot be read yet at cycle at
+    uint32_t blocked(uint32_t mask, uint64_t at) const {
+        uint32_t waiting = pending & mask, late = 0;
+        for (uint32_t rest = waiting; rest; rest &= rest - 1) {
+            uint32_t r = uint32_t(__builtin_ctz(rest));
+            if (ready[r] > at) late |= 1u << r;
+        }
+        return late;
+    }
+
+    // Of a non-empty mask, the register whose newest producer issued last
+    uint32_t youngest(uint32_t mask) const {
+        uint32_t best = uint32_t(__builtin_ctz(mask));
+        for (uint32_t rest = mask & (mask - 1); rest; rest &= rest - 1) {
+            uint32_t r = uint32_t(__builtin_ctz(rest));
+            if (issued[r] > issued[best]) best = r;
+        }
+        return best;
+    }
+
+    uint64_t issuedAt(uint32_t r) const { return issued[r]; }
+    uint32_t producerOf(uint32_t r) const { return producer[r]; }
+};
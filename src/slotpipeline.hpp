@@ -0,0 +1,532 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "pipeline.hpp"
+
+using namespace std;
+
+// One instruction in a slot of the wide pipeline
+struct SlotOp {
+    uint32_t pc = 0;
+    uint32_t predicted_pc = 0; // Where fetch went after it
+    uint64_t seq = 0;          // Diagram row
+    uint32_t a = 0, b = 0;     // rs1 and rs2 (store data) values
+    uint32_t result = 0;       // What it writes to rd: the ALU result, then the loaded data
+    int busy = 0;              // Further cycles it needs in its stage
+    bool fresh = true;         // Its stage has not worked on it yet
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& op) {
+        ar.field(op.pc); ar.field(op.predicted_pc); ar.field(op.seq);
+        ar.field(op.a); ar.field(op.b); ar.field(op.result);
+        ar.field(op.busy); ar.field(op.fresh);
+    }
+};
+
+// In-order pipeline described by data rather than by fixed latches:
+// config.layout lists its stages, any of which may be split in two for a
+// deeper pipeline, and each stage holds up to issueWidth instructions in
+// slots for a superscalar one. Processor stays the classic five-stage,
+// one-wide core.
+//
+// Fetch brings in up to a group of consecutive instructions per cycle,
+// ending it after a predicted-taken branch or at an instruction cache line
+// boundary. The stage in front of EX (ID, or RR when there is a register
+// read stage) issues the oldest instructions of its group that have their
+// operands, stopping at the first one that depends on an older
+// instruction in the same group or finds the cycle's memory ports or
+// branch units taken. Stages behind it move their whole group at once,
+// only into an empty stage, so a load waiting in MEM holds everything
+// behind it as the five-stage pipeline does.
+//
+// Hazard distances, forwarding windows and branch penalties follow from
+// the stage positions. With forwarding, an instruction may issue once its
+// producer will have passed the last stage that computes its result (EX,
+// or MEM for a load) by the time it needs the value (in EX, or at issue
+// for a branch resolving "in ID"); without forwarding, once the producer
+// has reached write back. A branch resolves at issue or at the end of EX
+// and squashes every instruction fetched behind it. The HazardPolicy
+// only contributes name and forwards; its readyAfter() and check_stall()
+// describe the fixed latches of Processor.
+//
+// Groups held at different stages keep apart producers that issued
+// together, so ready cycles would not say where a result is. The
+// scoreboard here only tracks which registers have a write in flight past
+// issue, and an operand without one skips the search for its producer.
+template <typename HazardPolicy>
+class SlotPipeline : public CoreDriver<SlotPipeline<HazardPolicy>> {
+private:
+    friend class CoreDriver<SlotPipeline>;
+
+    const Program& program; // Shared, read-only
+    PipelineConfig config;
+    vector<Stage> layout; // What each stage does, front to back
+    size_t width;
+    int issue = 0, exFirst = 0, exLast = 0, memFirst = 0, memLast = 0, wb = 0; // Positions in layout
+    vector<uint32_t> registers; // 32 registers
+    PagedMemory dataMemory;
+    vector<vector<SlotOp>> stages; // Per stage, oldest first
+    vector<size_t> leaving; // Per stage, how many of its oldest move on this cycle
+    uint32_t pc = 0;
+    uint64_t cycle = 0; // Cycles simulated so far, across checkpoints
+    int fetch_block = 0; // Fetch cycles still lost to a redirect's branch penalty
+    uint32_t branch_source = 0; // pc of the branch that redirected fetch last
+    Cache icache, dcache;
+    BranchPredictor predictor;
+    HotspotProfiler* profiler = nullptr; // Charged with every lost cycle while set
+    Scoreboard scoreboard; // Writes in flight between issue and write back
+    uint64_t retired = 0;
+    uint64_t stall_cycles = 0;
+    array<uint64_t, NUM_STALL_CAUSES> stall_causes{};
+    uint64_t branch_bubbles = 0;
+    uint64_t mem_stall_cycles = 0;
+    uint64_t fetch_stall_cycles = 0;
+    StageTracker tracker; // In-flight rows of the pipeline diagram
+
+    // Every field a checkpoint carries, in file order
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& p) {
+        ar.field(p.cycle);
+        ar.field(p.pc);
+        ar.field(p.fetch_block);
+        ar.field(p.branch_source);
+        ar.field(p.retired);
+        ar.field(p.stall_cycles);
+        ar.field(p.stall_causes);
+        ar.field(p.branch_bubbles);
+        ar.field(p.mem_stall_cycles);
+        ar.field(p.fetch_stall_cycles);
+        ar.array(p.registers, 32);
+        ar.memory(p.dataMemory);
+        for (auto& stage : p.stages) ar.array(stage);
+        ar.field(p.scoreboard);
+        ar.field(p.icache);
+        ar.field(p.dcache);
+        ar.field(p.predictor);
+    }
+
+    // Policy name, width and stages, which a checkpoint must match
+    string shape() const {
+        return string(HazardPolicy::name) + ", " + to_string(width) + "-wide, " + layoutName(layout);
+    }
+
+    const DecodedInstr& decoded(const SlotOp& op) const { return program.decoded[program.index(op.pc)]; }
+
+    bool writes(const SlotOp& op, uint32_t r) const {
+        const DecodedInstr& d = decoded(op);
+        return r != 0 && d.ctrl.regWrite && d.rd == r;
+    }
+
+    // The youngest instruction past stage s that writes r, and its stage
+    pair<int, const SlotOp*> producerOf(uint32_t r, int s) const {
+        for (int later = s + 1; later <= wb; later++) {
+            for (auto it = stages[later].rbegin(); it != stages[later].rend(); ++it) {
+                if (writes(*it, r)) return {later, &*it};
+            }
+        }
+        return {-1, nullptr};
+    }
+
+    // Operand r for an instruction in stage s as the bypass network sees
+    // it: the result of the youngest producer still in flight, otherwise
+    // the register file. The hazard checks guarantee that result is there.
+    uint32_t operand(uint32_t r, int s) const {
+        if (r == 0) return 0;
+        if (!(scoreboard.inFlight() & (1u << r))) return registers[r];
+        const SlotOp* producer = producerOf(r, s).second;
+        return producer ? producer->result : registers[r];
+    }
+
+    // Why the instruction in slot k of the issue stage cannot issue yet;
+    // culprit is set to the instruction it waits on. Called once this
+    // cycle's moves behind issue are decided.
+    StallCause hazard(size_t k, uint32_t& culprit) const {
+        const SlotOp& op = stages[issue][k];
+        const DecodedInstr& d = decoded(op);
+        bool resolvesHere = d.ctrl.branch && config.branchStage == STAGE_ID;
+        for (uint32_t r : {d.uses_rs1 ? uint32_t(d.rs1) : 0u, d.uses_rs2 ? uint32_t(d.rs2) : 0u}) {
+            if (r == 0) continue;
+            for (size_t older = k; older-- > 0;) {
+                if (writes(stages[issue][older], r)) {
+                    culprit = stages[issue][older].pc;
+                    return STALL_PAIRING;
+                }
+            }
+            if (!(scoreboard.inFlight() & (1u << r))) continue;
+            auto [p, producer] = producerOf(r, issue);
+            if (!producer) continue;
+            culprit = producer->pc;
+            bool load = decoded(*producer).ctrl.memRead;
+            if constexpr (HazardPolicy::forwards) {
+                // A branch resolving here uses the operand now, anything
+                // else in EX next cycle, when the producer is one stage on
+                // unless its stage is held
+                int at = resolvesHere ? p : p + (leaving[p] ? 1 : 0);
+                if (at <= (load ? memLast : exLast)) {
+                    return resolvesHere && !(load && p <= exLast) ? STALL_BRANCH_OPERAND : STALL_LOAD_USE;
+                }
+            } else if (p < wb) {
+                return p <= exLast ? STALL_RAW_EX : STALL_RAW_MEM;
+            }
+        }
+        return STALL_NONE;
+    }
+
+    // A wrong-path instruction leaves stage s
+    void squash(const SlotOp& op, int s, uint32_t source) {
+        if (s > issue) scoreboard.retire(decoded(op));
+        tracker.squash(op.seq);
+        branch_bubbles++;
+        if (profiler) profiler->charge(source, COST_BRANCH);
+    }
+
+    // Resolve the branch in slot k of stage s. Without a predictor fetch
+    // always restarts behind it; with one only when it went the wrong way.
+    // Everything younger is squashed then. Returns whether fetch restarts.
+    bool resolveBranch(int s, size_t k) {
+        const SlotOp& op = stages[s][k];
+        const DecodedInstr& d = decoded(op);
+        bool taken = d.opcode != 0x63 || branchTaken(d, op.a, op.b);
+        uint32_t next = taken ? branchTarget(d, op.pc, op.a) : op.pc + 4;
+        if (predictor.enabled() && !predictor.resolve(d, op.pc, taken, next, op.predicted_pc)) return false;
+        for (size_t younger = k + 1; younger < stages[s].size(); younger++) squash(stages[s][younger], s, op.pc);
+        stages[s].resize(k + 1);
+        for (int earlier = 0; earlier < s; earlier++) {
+            for (const SlotOp& wrong : stages[earlier]) squash(wrong, earlier, op.pc);
+            stages[earlier].clear();
+        }
+        pc = next;
+        fetch_block = config.branchPenalty;
+        branch_source = op.pc;
+        return true;
+    }
+
+    // Fetch a group into the free slots of the first stage
+    void fetch() {
+        if (fetch_block > 0) {
+            fetch_block--;
+            branch_bubbles++;
+            if (profiler) profiler->charge(branch_source, COST_BRANCH);
+            return;
+        }
+        vector<SlotOp>& front = stages[0];
+        if (front.size() == width || !program.contains(pc)) return;
+        // One instruction cache lookup covers the group: it stays on one line
+        int wait = icache.access(pc, false);
+        uint32_t line = pc / config.l1i.lineSize;
+        while (front.size() < width && program.contains(pc) && (!icache.enabled() || pc / config.l1i.lineSize == line)) {
+            SlotOp op;
+            op.pc = pc;
+            op.seq = tracker.open(pc);
+            op.busy = wait;
+            op.predicted_pc = predictor.enabled() ? predictor.predict(pc) : pc + 4;
+            front.push_back(op);
+            pc = op.predicted_pc;
+            if (pc != op.pc + 4) break;
+        }
+    }
+
+    // Record stage entries for the pipeline diagram and list the stages
+    template <TraceLevel L>
+    void recordStages() {
+        TraceStream<(L >= TraceLevel::Stage)> trace;
+        trace << "Current Stage Instructions:\n";
+        for (size_t s = 0; s < stages.size(); s++) {
+            bool second = s > 0 && layout[s - 1] == layout[s];
+            trace << (second ? splitStageNames[layout[s]] : stageNames[layout[s]]) << ":";
+            if (stages[s].empty()) trace << " invalid";
+            for (size_t k = 0; k < stages[s].size(); k++) {
+                tracker.enter(stages[s][k].seq, layout[s], int64_t(cycle), uint8_t(k), second);
+                trace << " " << (program.index(stages[s][k].pc) + 1);
+            }
+            trace << "\n";
+        }
+    }
+
+    // What each stage does to an instruction in its first cycle there,
+    // back to front so EX sees the results MEM and WB hold this cycle. A
+    // split stage does the work in its first half; a branch resolves in
+    // the last EX stage.
+    void work() {
+        for (int s = wb; s >= 0; s--) {
+            for (size_t k = 0; k < stages[s].size(); k++) {
+                SlotOp& op = stages[s][k];
+                if (!op.fresh) continue;
+                op.fresh = false;
+                const DecodedInstr& d = decoded(op);
+                if (s == wb) {
+                    retired++;
+                    scoreboard.retire(d);
+                    if (d.ctrl.regWrite && d.rd != 0) registers[d.rd] = op.result;
+                } else if (s == memFirst) {
+                    int latency = d.ctrl.memRead ? config.loadLatency : 1;
+                    if (d.ctrl.memRead || d.ctrl.memWrite) latency += dcache.access(op.result, d.ctrl.memWrite);
+                    if (d.ctrl.memRead) op.result = loadData(dataMemory, op.result, d.funct3);
+                    else if (d.ctrl.memWrite) storeData(dataMemory, op.result, op.b, d.funct3);
+                    op.busy = latency - 1;
+                } else if (s == exFirst) {
+                    if constexpr (HazardPolicy::forwards) {
+                        op.a = d.uses_rs1 ? operand(d.rs1, s) : 0;
+                        op.b = d.uses_rs2 ? operand(d.rs2, s) : 0;
+                    }
+                    op.result = aluResult(d, op.pc, op.a, op.b);
+                }
+                if (s == exLast && d.ctrl.branch && config.branchStage == STAGE_EX && resolveBranch(s, k)) break;
+            }
+        }
+    }
+
+    // Decide which instructions move on, back to front, then move them.
+    // Returns the number issued.
+    size_t advance() {
+        // Write back always drains; behind it a stage passes its whole
+        // group on once nothing in it is busy and the next stage empties
+        leaving[wb] = stages[wb].size();
+        bool frozen = false;
+        for (int s = wb - 1; s > issue; s--) {
+            const SlotOp* held = nullptr;
+            for (SlotOp& op : stages[s]) {
+                if (op.busy > 0) {
+                    op.busy--;
+                    held = &op;
+                }
+            }
+            frozen |= held != nullptr;
+            if (held && s >= memFirst && s <= memLast) {
+                mem_stall_cycles++;
+                if (profiler) profiler->charge(held->pc, COST_MEMORY);
+            }
+            leaving[s] = !held && stages[s + 1].size() == leaving[s + 1] ? stages[s].size() : 0;
+        }
+
+        // Issue the oldest instructions that are free to go
+        size_t room = stages[issue + 1].size() == leaving[issue + 1] ? width : 0;
+        size_t issued = 0;
+        int memOps = 0, branchOps = 0;
+        StallCause cause = STALL_NONE;
+        uint32_t culprit = 0;
+        while (issued < stages[issue].size() && issued < room) {
+            SlotOp& op = stages[issue][issued];
+            const DecodedInstr& d = decoded(op);
+            bool mem = d.ctrl.memRead || d.ctrl.memWrite;
+            cause = hazard(issued, culprit);
+            if (cause == STALL_NONE && ((mem && memOps == config.memPorts) || (d.ctrl.branch && branchOps == config.branchUnits))) {
+                cause = STALL_PORT;
+                culprit = op.pc;
+            }
+            if (cause != STALL_NONE) break;
+            memOps += mem;
+            branchOps += d.ctrl.branch;
+            op.a = registers[d.rs1];
+            op.b = registers[d.rs2];
+            scoreboard.issue(d, op.pc, cycle);
+            issued++;
+            if (d.ctrl.branch && config.branchStage == STAGE_ID) {
+                if constexpr (HazardPolicy::forwards) {
+                    op.a = d.uses_rs1 ? operand(d.rs1, issue) : 0;
+                    op.b = d.uses_rs2 ? operand(d.rs2, issue) : 0;
+                }
+                if (resolveBranch(issue, issued - 1)) break;
+            }
+        }
+        leaving[issue] = issued;
+        // Cycles the back end is held count as memory stalls only
+        if (cause != STALL_NONE && !frozen) {
+            stall_causes[cause]++;
+            stall_cycles += issued == 0;
+            if (profiler) profiler->charge(culprit, COST_STALL);
+        }
+
+        // In front of issue, stages fill whatever room the next one has
+        for (int s = issue - 1; s >= 0; s--) {
+            size_t room = width - (stages[s + 1].size() - leaving[s + 1]);
+            vector<SlotOp>& group = stages[s];
+            if (!group.empty() && group[0].busy > 0 && layout[s] == STAGE_IF) {
+                fetch_stall_cycles++;
+                if (profiler) profiler->charge(group[0].pc, COST_FETCH);
+            }
+            size_t n = 0;
+            while (n < group.size() && n < room && group[n].busy == 0) n++;
+            for (SlotOp& op : group) {
+                if (op.busy > 0) op.busy--;
+            }
+            leaving[s] = n;
+        }
+
+        // Move, back to front, so each group lands behind what stays
+        stages[wb].erase(stages[wb].begin(), stages[wb].begin() + leaving[wb]);
+        for (int s = wb - 1; s >= 0; s--) {
+            auto begin = stages[s].begin(), end = begin + leaving[s];
+            for (auto it = begin; it != end; ++it) {
+                it->fresh = true;
+                stages[s + 1].push_back(*it);
+            }
+            stages[s].erase(begin, end);
+        }
+        return issued;
+    }
+
+    // Cycles after this one in which nothing moves and only busy counts
+    // down: a load or data cache miss holding the back end, or an
+    // instruction cache miss in fetch, with everything around it unable to
+    // move until it finishes. With nothing fresh nothing moved last cycle,
+    // so leaving[] behind issue is all zero, as hazard() expects.
+    uint64_t idleCycles() const {
+        if (fetch_block > 0 || (stages[0].size() < width && program.contains(pc))) return 0;
+        uint64_t idle = UINT64_MAX;
+        for (const auto& stage : stages) {
+            for (const SlotOp& op : stage) {
+                if (op.fresh) return 0;
+                if (op.busy > 0) idle = min(idle, uint64_t(op.busy));
+            }
+        }
+        if (idle == UINT64_MAX) return 0;
+
+        // Behind issue, a stage stays while something in it is busy or the
+        // next one stays full
+        bool frozen = false;
+        for (int s = wb - 1; s > issue; s--) {
+            bool held = any_of(stages[s].begin(), stages[s].end(), [](const SlotOp& op) { return op.busy > 0; });
+            frozen |= held;
+            if (!stages[s].empty() && !held && stages[s + 1].empty()) return 0;
+        }
+        // Issue waits on a hazard, which counts no stall while frozen
+        uint32_t culprit = 0;
+        if (!stages[issue].empty() && stages[issue + 1].empty() && (!frozen || hazard(0, culprit) == STALL_NONE)) return 0;
+        // In front of it, nothing ready has room to move
+        for (int s = issue - 1; s >= 0; s--) {
+            const vector<SlotOp>& group = stages[s];
+            if (!group.empty() && group[0].busy == 0 && stages[s + 1].size() < width) return 0;
+        }
+        return idle;
+    }
+
+    // Jump over n idle cycles, counting them as advance() would have. The
+    // rows in flight stay in their stages until the last of them.
+    template <TraceLevel L>
+    void skipIdle(uint64_t n) {
+        for (int s = wb - 1; s > issue; s--) {
+            const SlotOp* held = nullptr;
+            for (SlotOp& op : stages[s]) {
+                if (op.busy > 0) {
+                    op.busy -= int(n);
+                    held = &op;
+                }
+            }
+            if (held && s >= memFirst && s <= memLast) {
+                mem_stall_cycles += n;
+                if (profiler) profiler->charge(held->pc, COST_MEMORY, n);
+            }
+        }
+        for (int s = issue - 1; s >= 0; s--) {
+            vector<SlotOp>& group = stages[s];
+            if (!group.empty() && group[0].busy > 0 && layout[s] == STAGE_IF) {
+                fetch_stall_cycles += n;
+                if (profiler) profiler->charge(group[0].pc, COST_FETCH, n);
+            }
+            for (SlotOp& op : group) {
+                if (op.busy > 0) op.busy -= int(n);
+            }
+        }
+        cycle += n - 1;
+        recordStages<L>();
+        tracker.drain();
+        cycle++;
+    }
+
+    bool empty() const {
+        for (const auto& stage : stages) {
+            if (!stage.empty()) return false;
+        }
+        return true;
+    }
+
+public:
+    SlotPipeline(const Program& program, const PipelineConfig& config = PipelineConfig())
+        : SlotPipeline(program, initialState(program), config) {}
+
+    // Start the pipeline empty at state.pc, e.g. after a functional fast-forward
+    SlotPipeline(const Program& program, const ArchState& state, const PipelineConfig& config = PipelineConfig())
+        : program(program), config(config), layout(config.layout), width(size_t(max(1, config.issueWidth))),
+          registers(state.registers), dataMemory(state.dataMemory), pc(state.pc), icache(config.l1i),
+          dcache(config.l1d), predictor(config.predictor) {
+        exFirst = int(find(layout.begin(), layout.end(), STAGE_EX) - layout.begin());
+        issue = exFirst - 1;
+        exLast = int(layout.rend() - find(layout.rbegin(), layout.rend(), STAGE_EX)) - 1;
+        memFirst = int(find(layout.begin(), layout.end(), STAGE_MEM) - layout.begin());
+        memLast = int(layout.rend() - find(layout.rbegin(), layout.rend(), STAGE_MEM)) - 1;
+        wb = int(layout.size()) - 1;
+        stages.resize(layout.size());
+        leaving.resize(layout.size());
+    }
+
+    // Save the complete simulator state, as Processor::saveCheckpoint() does
+    void saveCheckpoint(const string& path) const {
+        CheckpointWriter out;
+        out.magic();
+        out.text(shape());
+        out.field(programHash(program.instrMemory));
+        out.field(uint32_t(program.instrMemory.size()));
+        checkpointFields(out, *this);
+        out.field(tracker.nextSeq());
+        out.array(tracker.inflightRecords());
+        out.save(path);
+    }
+
+    // Resume from a checkpoint taken on the same program, hazard policy
+    // and issue width
+    void restoreCheckpoint(const string& path) {
+        CheckpointReader in(path);
+        in.magic();
+        string taken;
+        in.text(taken);
+        if (taken != shape()) {
+            throw runtime_error("checkpoint " + path + " was taken in " + taken + " mode");
+        }
+        uint64_t hash;
+        uint32_t size;
+        in.field(hash);
+        in.field(size);
+        if (hash != programHash(program.instrMemory) || size != program.instrMemory.size()) {
+            throw runtime_error("checkpoint " + path + " was taken on a different program");
+        }
+        checkpointFields(in, *this);
+        uint64_t seq;
+        vector<StageRecord> records;
+        in.field(seq);
+        in.array(records);
+        // Instructions in flight and diagram rows index the program by pc,
+        // and no stage holds more than a group
+        bool bad = false;
+        for (const auto& stage : stages) {
+            bad = bad || stage.size() > width;
+            for (const SlotOp& op : stage) bad = bad || !program.contains(op.pc);
+        }
+        for (const StageRecord& rec : records) bad = bad || !program.contains(rec.pc);
+        if (bad) {
+            throw runtime_error("checkpoint " + path + " holds instructions outside the program or the issue width");
+        }
+        tracker.restore(records, seq);
+    }
+
+    // Charge lost cycles to the profiler, which must also be the diagram
+    // writer simulate() is given; nullptr to stop
+    void setProfiler(HotspotProfiler* p) { profiler = p; }
+
+    // Simulate one cycle
+    template <TraceLevel L>
+    void step() {
+        TraceStream<(L >= TraceLevel::Cycle)> trace;
+        trace << "Cycle " << cycle + 1 << ":\n";
+        fetch();
+        recordStages<L>();
+        tracker.drain();
+        work();
+        size_t waiting = stages[issue].size();
+        size_t issued = advance();
+        trace << "Issued: " << issued << " of " << waiting << "\n";
+        trace << "----------------------------------------\n";
+        cycle++;
+    }
+
+    bool drained() const { return empty() && !program.contains(pc); }
+};
@@ -0,0 +1,241 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "runner.hpp"
+#include "batch.hpp"
+
+using namespace std;
+
+// One point of the design space: a hazard policy plus its timing parameters
+struct SweepPoint {
+    bool forwarding = true;
+    PipelineConfig config;
+};
+
+// Relative hardware cost of a design point, in arbitrary units. Forwarding
+// needs bypass paths and muxes, resolving branches in ID needs a comparator
+// (and bypasses into it) there, and every cycle shaved off load latency or
+// branch redirect needs faster memory or fetch logic.
+inline int hardwareCost(const SweepPoint& p) {
+    int cost = 10;
+    if (p.forwarding) cost += 4;
+    if (p.config.branchStage == STAGE_ID) cost += 2;
+    cost += 2 * max(0, 4 - p.config.loadLatency);
+    cost += max(0, 2 - p.config.branchPenalty);
+    return cost;
+}
+
+// Parameter ranges to sweep; the design space is their cross product
+struct SweepSpec {
+    vector<bool> forwarding = {true, false};
+    vector<Stage> branchStages = {STAGE_ID, STAGE_EX};
+    vector<int> loadLatencies = {1, 2, 3};
+    vector<int> branchPenalties = {0, 1};
+    CacheConfig l1i, l1d; // The same caches at every point
+    PredictorConfig predictor; // And the same branch predictor
+    int issueWidth = 1, memPorts = 1, branchUnits = 1; // And the same issue width
+    vector<Stage> layout = PipelineConfig().layout;     // And stages
+
+    vector<SweepPoint> points() const {
+        vector<SweepPoint> result;
+        for (bool fwd : forwarding)
+            for (Stage stage : branchStages)
+                for (int latency : loadLatencies)
+                    for (int penalty : branchPenalties) {
+                        SweepPoint p;
+                        p.forwarding = fwd;
+                        p.config.branchStage = stage;
+                        p.config.loadLatency = latency;
+                        p.config.branchPenalty = penalty;
+                        p.config.l1i = l1i;
+                        p.config.l1d = l1d;
+                        p.config.predictor = predictor;
+                        p.config.issueWidth = issueWidth;
+                        p.config.memPorts = memPorts;
+                        p.config.branchUnits = branchUnits;
+                        p.config.layout = layout;
+                        result.push_back(p);
+                    }
+        return result;
+    }
+};
+
+// Parse "1-3", "1,2,4" or a mix like "1,3-5" into the values it names
+inline bool parseIntRange(const string& text, int lowest, vector<int>& values) {
+    values.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t dash = item.find('-', 1);
+        try {
+            int lo = stoi(item.substr(0, dash));
+            int hi = (dash == string::npos) ? lo : stoi(item.substr(dash + 1));
+            if (lo < lowest || hi < lo) return false;
+            for (int v = lo; v <= hi; v++) values.push_back(v);
+        } catch (const exception&) {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+inline bool parseOnOff(const string& text, vector<bool>& values) {
+    values.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item == "on") values.push_back(true);
+        else if (item == "off") values.push_back(false);
+        else return false;
+    }
+    return !values.empty();
+}
+
+inline bool parseBranchStages(const string& text, vector<Stage>& values) {
+    values.clear();
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        Stage stage;
+        if (!parseBranchStage(item, stage)) return false;
+        values.push_back(stage);
+    }
+    return !values.empty();
+}
+
+// Evaluate every design point over every program on a work-stealing pool,
+// with the loaded programs shared read-only by all workers. Writes
+// <outDir>/sweep.csv, prints the table and the points on the Pareto front
+// of CPI versus hardware cost. A point on which any program fails is
+// reported with its error and left off the front. Returns the number of
+// programs that failed to load or to run.
+inline size_t runSweep(const vector<string>& paths, const SweepSpec& spec, uint64_t cycles, const string& outDir, size_t threads) {
+    ThreadPool pool(threads);
+    auto start = chrono::steady_clock::now();
+    vector<string> loadErrors;
+    vector<Program> programs = loadPrograms(pool, paths, loadErrors);
+    vector<bool> programFailed(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!loadErrors[i].empty()) {
+            cerr << loadErrors[i] << endl;
+            programFailed[i] = true;
+        }
+    }
+
+    vector<SweepPoint> points = spec.points();
+    const ModeEntry& forward = *findMode(ForwardingPolicy::name);
+    const ModeEntry& noforward = *findMode(NoForwardingPolicy::name);
+    // results[point][program] and errors[point][program], each slot written
+    // by exactly one task
+    vector<vector<SimResult>> results(points.size(), vector<SimResult>(paths.size()));
+    vector<vector<string>> errors(points.size(), vector<string>(paths.size()));
+    for (size_t p = 0; p < points.size(); p++) {
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!loadErrors[i].empty()) continue;
+            pool.submit([&, p, i] {
+                const ModeEntry& mode = points[p].forwarding ? forward : noforward;
+                RunOptions run;
+                run.start = initialState(programs[i]);
+                run.config = points[p].config;
+                run.cycles = cycles;
+                try {
+                    results[p][i] = mode.run(programs[i], run);
+                } catch (const exception& e) {
+                    errors[p][i] = e.what();
+                }
+            });
+        }
+    }
+    pool.wait();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    struct Row {
+        size_t point;
+        int cost;
+        SimResult total;
+        string error;
+        bool pareto = false;
+    };
+    vector<Row> rows;
+    for (size_t p = 0; p < points.size(); p++) {
+        Row row{p, hardwareCost(points[p]), SimResult()};
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (errors[p][i].empty()) {
+                addResult(row.total, results[p][i]);
+            } else {
+                if (row.error.empty()) row.error = paths[i] + ": " + errors[p][i];
+                programFailed[i] = true;
+            }
+        }
+        rows.push_back(row);
+    }
+
+    // A point is on the front if no point is both no more expensive and faster
+    vector<size_t> order(rows.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (rows[a].cost != rows[b].cost) return rows[a].cost < rows[b].cost;
+        return cpi(rows[a].total) < cpi(rows[b].total);
+    });
+    double best = numeric_limits<double>::infinity();
+    for (size_t index : order) {
+        if (!rows[index].error.empty()) continue;
+        double c = cpi(rows[index].total);
+        if (c < best) {
+            rows[index].pareto = true;
+            best = c;
+        }
+    }
+
+    auto describe = [&](ostream& out, const Row& row, const char* sep) {
+        const SweepPoint& p = points[row.point];
+        out << (p.forwarding ? "on" : "off") << sep << stageNames[p.config.branchStage] << sep
+            << p.config.loadLatency << sep << p.config.branchPenalty << sep << row.cost << sep;
+        if (!row.error.empty()) {
+            out << sep << sep << sep << sep << sep;
+            return;
+        }
+        out << row.total.cycles << sep << row.total.retired << sep
+            << fixed << setprecision(3) << cpi(row.total) << defaultfloat << sep
+            << row.total.stall_cycles << sep << row.total.branch_bubbles << sep << row.total.mem_stall_cycles;
+    };
+
+    string csvPath = outDir + "/sweep.csv";
+    ofstream csv(csvPath);
+    if (!csv.is_open()) {
+        throw runtime_error("Error opening " + csvPath);
+    }
+    csv << "forwarding;branch_stage;load_latency;branch_penalty;cost;cycles;instructions;cpi;stall_cycles;"
+        << "branch_bubbles;mem_stall_cycles;pareto;error\n";
+    for (const Row& row : rows) {
+        describe(csv, row, ";");
+        csv << ";" << row.pareto << ";" << row.error << "\n";
+    }
+
+    cout << "Sweep: " << points.size() << " design points x " << paths.size() << " programs on " << pool.size()
+         << " threads in " << fixed << setprecision(2) << seconds << "s" << defaultfloat << "\n";
+    cout << left << setw(5) << "fwd" << setw(8) << "branch" << setw(6) << "load" << setw(9) << "penalty"
+         << setw(6) << "cost" << setw(8) << "CPI" << "pareto\n";
+    for (const Row& row : rows) {
+        const SweepPoint& p = points[row.point];
+        cout << setw(5) << (p.forwarding ? "on" : "off") << setw(8) << stageNames[p.config.branchStage]
+             << setw(6) << p.config.loadLatency << setw(9) << p.config.branchPenalty << setw(6) << row.cost;
+        if (row.error.empty()) {
+            cout << setw(8) << fixed << setprecision(3) << cpi(row.total) << defaultfloat << (row.pareto ? "*" : "") << "\n";
+        } else {
+            cout << setw(8) << "-" << "failed (" << row.error << ")\n";
+        }
+    }
+    cout << right;
+
+    cout << "Pareto front (CPI vs hardware cost):\n";
+    for (size_t index : order) {
+        if (!rows[index].pareto) continue;
+        const SweepPoint& p = points[rows[index].point];
+        cout << "  cost " << rows[index].cost << ": CPI " << fixed << setprecision(3) << cpi(rows[index].total)
+             << defaultfloat << " (forwarding " << (p.forwarding ? "on" : "off") << ", branch in "
+             << stageNames[p.config.branchStage] << ", load latency " << p.config.loadLatency
+             << ", branch penalty " << p.config.branchPenalty << ")\n";
+    }
+    cout << "Table written to " << csvPath << "\n";
+    return count(programFailed.begin(), programFailed.end(), true);
+}
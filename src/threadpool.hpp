@@ -0,0 +1,104 @@
+#pragma once
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own
+// work from the back and, when that runs dry, steals from the front of the
+// other workers' deques, so long and short jobs balance out across cores.
+class ThreadPool {
+    struct Queue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+    atomic<size_t> queued{0};   // Tasks sitting in some deque
+    atomic<size_t> pending{0};  // Tasks submitted but not finished
+    atomic<size_t> nextQueue{0};
+    mutex sleepLock;
+    condition_variable wake, idle;
+    bool stopping = false;
+
+    inline static thread_local ThreadPool* currentPool = nullptr;
+    inline static thread_local size_t currentIndex = 0;
+
+    bool popOwn(size_t index, function<void()>& task) {
+        Queue& q = *queues[index];
+        lock_guard<mutex> guard(q.lock);
+        if (q.tasks.empty()) return false;
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, function<void()>& task) {
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue& q = *queues[(thief + k) % queues.size()];
+            lock_guard<mutex> guard(q.lock);
+            if (q.tasks.empty()) continue;
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        currentPool = this;
+        currentIndex = index;
+        while (true) {
+            function<void()> task;
+            if (popOwn(index, task) || steal(index, task)) {
+                queued--;
+                task();
+                if (--pending == 0) {
+                    lock_guard<mutex> guard(sleepLock);
+                    idle.notify_all();
+                }
+                continue;
+            }
+            unique_lock<mutex> guard(sleepLock);
+            wake.wait(guard, [&] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threads = 0) {
+        if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+        for (size_t i = 0; i < threads; i++) queues.push_back(make_unique<Queue>());
+        for (size_t i = 0; i < threads; i++) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) worker.join();
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // Tasks submitted from a worker stay on that worker's deque
+    void submit(function<void()> task) {
+        size_t index = (currentPool == this) ? currentIndex : nextQueue++ % queues.size();
+        pending++;
+        queued++;
+        {
+            lock_guard<mutex> guard(queues[index]->lock);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        lock_guard<mutex> guard(sleepLock);
+        wake.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        unique_lock<mutex> guard(sleepLock);
+        idle.wait(guard, [&] { return pending == 0; });
+    }
+};
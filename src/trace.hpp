@@ -0,0 +1,200 @@
+#pragma once
+#include <bits/stdc++.h>
+
+using namespace std;
+
+// How much the simulator prints to stdout while it runs.
+// Off:     nothing (headless runs, only the pipeline diagram file is written)
+// Summary: one block of totals once simulate() finishes
+// Cycle:   cycle header, stall/NOP banners and the post-cycle latch state
+// Stage:   everything above plus the per-stage listing of every cycle
+enum class TraceLevel { Off = 0, Summary = 1, Cycle = 2, Stage = 3 };
+
+inline bool parseTraceLevel(const string& name, TraceLevel& level) {
+    if (name == "off" || name == "0") level = TraceLevel::Off;
+    else if (name == "summary" || name == "1") level = TraceLevel::Summary;
+    else if (name == "cycle" || name == "2") level = TraceLevel::Cycle;
+    else if (name == "stage" || name == "3") level = TraceLevel::Stage;
+    else return false;
+    return true;
+}
+
+// Stand-in for cout that compiles to nothing when the level is disabled,
+// so trace statements cost nothing in headless builds of simulate().
+template <bool Enabled>
+struct TraceStream {
+    template <typename T>
+    TraceStream& operator<<(const T& value) { cout << value; return *this; }
+    TraceStream& operator<<(ostream& (*manip)(ostream&)) { cout << manip; return *this; }
+    TraceStream& operator<<(ios_base& (*manip)(ios_base&)) { cout << manip; return *this; }
+};
+
+template <>
+struct TraceStream<false> {
+    template <typename T>
+    TraceStream& operator<<(const T&) { return *this; }
+    TraceStream& operator<<(ostream& (*)(ostream&)) { return *this; }
+    TraceStream& operator<<(ios_base& (*)(ios_base&)) { return *this; }
+};
+
+// Pipeline stages as they appear in the diagram
+enum Stage { STAGE_IF = 0, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_WB, NUM_STAGES };
+
+static const char* const stageNames[NUM_STAGES] = {"IF", "ID", "EX", "MEM", "WB"};
+
+// The second half of a stage a deeper pipeline splits in two: IF/IF2,
+// ID and a register-read stage, EX/EX2, MEM/MEM2
+static const char* const splitStageNames[NUM_STAGES] = {"IF2", "RR", "EX2", "MEM2", "WB2"};
+
+// One row of the pipeline diagram: a single dynamic instruction and the
+// cycle in which it entered each stage. Cycles between two entries are the
+// cycles it spent stalled in the earlier stage.
+struct StageRecord {
+    uint64_t seq = 0;       // Dynamic instruction number, starting at 1
+    uint32_t pc = 0;
+    int64_t enter[NUM_STAGES] = {-1, -1, -1, -1, -1};
+    int64_t last = -1;      // Last cycle the instruction was seen in any stage
+    uint8_t slot[NUM_STAGES] = {}; // Slot it took in each stage of a wide pipeline
+    uint16_t split[NUM_STAGES] = {}; // Cycles after enter[] it reached the second half of a split stage, 0 if not
+    bool squashed = false;  // Fetched on a wrong path and never decoded
+
+    bool done() const { return squashed || enter[STAGE_WB] >= 0; }
+
+    template <typename Archive, typename Self>
+    static void checkpointFields(Archive& ar, Self& r) {
+        ar.field(r.seq); ar.field(r.pc); ar.field(r.enter); ar.field(r.last); ar.field(r.slot); ar.field(r.split);
+        ar.field(r.squashed);
+    }
+};
+
+// Receives diagram rows in program order as instructions leave the pipeline
+class DiagramWriter {
+public:
+    virtual ~DiagramWriter() {}
+    virtual void write(const StageRecord& rec) = 0;
+    virtual void finish() {}
+};
+
+// Discards every row, for runs where only the totals matter
+class NullDiagramWriter : public DiagramWriter {
+public:
+    void write(const StageRecord&) override {}
+};
+
+// Write one "instruction;IF;ID;..." row covering cycles [from, min(to, rec.last)].
+// With slots, each stage entry also names its slot: "IF:0;ID:1;...".
+inline void writeDiagramRow(ostream& out, string_view text, const StageRecord& rec,
+                            int64_t from = 0, int64_t to = INT64_MAX, bool slots = false) {
+    out << text;
+    int stage = 0;
+    int64_t end = min(to, rec.last);
+    for (int64_t cycle = from; cycle <= end; cycle++) {
+        // Stages it never entered (MEM for an ALU instruction out of order) are skipped
+        for (int next = stage + 1; next < NUM_STAGES; next++) {
+            if (rec.enter[next] < 0) continue;
+            if (rec.enter[next] > cycle) break;
+            stage = next;
+        }
+        if (cycle < rec.enter[STAGE_IF]) {
+            out << "; ";
+        } else if (cycle == rec.enter[stage]) {
+            out << ";" << stageNames[stage];
+            if (slots) out << ":" << int(rec.slot[stage]);
+        } else if (rec.split[stage] && cycle == rec.enter[stage] + rec.split[stage]) {
+            out << ";" << splitStageNames[stage];
+        } else {
+            out << ";-";
+        }
+    }
+    out << "\n";
+}
+
+// The original "instruction;IF;ID;..." text diagram. Rows stop at the
+// instruction's last stage instead of being padded out to the cycle budget.
+// Wide pipelines add the slot to every stage entry.
+class TextDiagramWriter : public DiagramWriter {
+    ostream& out;
+    const vector<string_view>& instructions;
+    uint32_t base; // pc of instructions[0]
+    bool slots;
+public:
+    TextDiagramWriter(ostream& out, const vector<string_view>& instructions, uint32_t base = 0, bool slots = false)
+        : out(out), instructions(instructions), base(base), slots(slots) {}
+
+    void write(const StageRecord& rec) override {
+        writeDiagramRow(out, instructions[(rec.pc - base) / 4], rec, 0, INT64_MAX, slots);
+    }
+
+    void finish() override { out.flush(); }
+};
+
+// Keeps a record for every instruction currently in flight and streams it to
+// the writer once it retires (or is squashed), so memory use is bounded by the
+// pipeline depth rather than by cycles x program size.
+class StageTracker {
+    deque<StageRecord> inflight;
+    uint64_t next_seq = 1;
+    DiagramWriter* writer = nullptr;
+
+    StageRecord& at(uint64_t seq) { return inflight[seq - inflight.front().seq]; }
+
+public:
+    void setWriter(DiagramWriter* w) { writer = w; }
+
+    // Start a row for the instruction about to be fetched at pc
+    uint64_t open(uint32_t pc) {
+        StageRecord rec;
+        rec.seq = next_seq++;
+        rec.pc = pc;
+        inflight.push_back(rec);
+        return rec.seq;
+    }
+
+    // Note that instruction seq occupies stage (in the given slot, or in
+    // the second half of a split stage) in this cycle (seq 0 is a bubble)
+    void enter(uint64_t seq, Stage stage, int64_t cycle, uint8_t slot = 0, bool second = false) {
+        if (seq == 0) return;
+        StageRecord& rec = at(seq);
+        if (rec.enter[stage] < 0) {
+            rec.enter[stage] = cycle;
+            rec.slot[stage] = slot;
+        } else if (second && !rec.split[stage]) {
+            rec.split[stage] = uint16_t(min<int64_t>(cycle - rec.enter[stage], UINT16_MAX));
+        }
+        rec.last = cycle;
+    }
+
+    void squash(uint64_t seq) {
+        if (seq != 0) at(seq).squashed = true;
+    }
+
+    // Hand every finished row at the head of the window to the writer
+    void drain() {
+        while (!inflight.empty() && inflight.front().done()) {
+            if (writer) writer->write(inflight.front());
+            inflight.pop_front();
+        }
+    }
+
+    // Checkpoint support: the rows still in flight and the next row number
+    vector<StageRecord> inflightRecords() const { return vector<StageRecord>(inflight.begin(), inflight.end()); }
+    uint64_t nextSeq() const { return next_seq; }
+    void restore(const vector<StageRecord>& records, uint64_t seq) {
+        inflight.assign(records.begin(), records.end());
+        next_seq = seq;
+    }
+
+    // Pause: push buffered output to disk but keep the in-flight rows
+    void pause() {
+        if (writer) writer->finish();
+    }
+
+    // End of simulation: write out whatever is still in flight
+    void flush() {
+        while (!inflight.empty()) {
+            if (writer) writer->write(inflight.front());
+            inflight.pop_front();
+        }
+        if (writer) writer->finish();
+    }
+};
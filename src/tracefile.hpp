@@ -0,0 +1,342 @@
+#pragma once
+#include <bits/stdc++.h>
+#include "trace.hpp"
+
+using namespace std;
+
+// Binary pipeline trace, version 3. All integers are little-endian.
+// Version 1 and 2 files read the same: version 1 never sets the flags word,
+// and neither sets the split bit.
+//
+// Header:
+//   char[8]  "RVPTRACE"
+//   u16      version
+//   u16      flags: bit 0 = records carry issue slots (wide pipelines)
+//   u32      number of static instructions N
+//   N x { u32 pc, varint length, length bytes of instruction text }
+//
+// Followed by chunks until end of file:
+//   u32      payload size in bytes
+//   u32      number of records in the chunk
+//   u64      sequence number of the first record
+//   u64      IF cycle of the first record
+//   u64      last cycle touched by any record in the chunk
+//   payload: one entry per dynamic instruction, in program order
+//     varint   zigzag(pc - previous pc)       (previous pc is 0 at chunk start)
+//     u8       bit k = entered stage k, bit 5 = squashed, bit 6 = tail present,
+//              bit 7 = split stages present
+//     varint   IF cycle - previous IF cycle   (previous is the chunk's first IF)
+//     varint   cycles since the previous entered stage, for each later stage
+//     varint   last cycle - last stage entry  (only if the tail bit is set)
+//     u8       slot, for each entered stage    (only with the slots flag)
+//     varint   cycles from the stage entry to its second half, 0 if it has
+//              none, for each entered stage    (only if the split bit is set)
+//
+// Chunk headers carry absolute cycles, so readers can skip chunks outside a
+// cycle window with a seek and never hold more than one chunk in memory.
+
+static const char traceMagic[8] = {'R', 'V', 'P', 'T', 'R', 'A', 'C', 'E'};
+static const uint16_t traceVersion = 3;
+
+enum TraceFileFlags : uint16_t {
+    TRACE_FILE_SLOTS = 1 << 0,
+};
+
+enum TraceRecordFlags : uint8_t {
+    TRACE_SQUASHED = 1 << 5,
+    TRACE_TAIL = 1 << 6,
+    TRACE_SPLIT = 1 << 7,
+};
+
+inline void putVarint(vector<uint8_t>& buf, uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    buf.push_back(uint8_t(v));
+}
+
+inline uint64_t getVarint(const uint8_t*& p, const uint8_t* end) {
+    uint64_t v = 0;
+    int shift = 0;
+    while (p < end) {
+        uint8_t b = *p++;
+        v |= uint64_t(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+        shift += 7;
+    }
+    throw runtime_error("truncated varint in trace");
+}
+
+inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+template <typename T>
+void putLE(vector<uint8_t>& buf, T v) {
+    for (size_t i = 0; i < sizeof(T); i++) buf.push_back(uint8_t(uint64_t(v) >> (8 * i)));
+}
+
+template <typename T>
+T getLE(const uint8_t* p) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++) v |= uint64_t(p[i]) << (8 * i);
+    return T(v);
+}
+
+// Writes the binary trace through a chunk buffer and a large stdio buffer
+class BinaryTraceWriter : public DiagramWriter {
+    static const size_t chunkRecords = 4096;
+    static const size_t headerBytes = 4 + 4 + 8 + 8 + 8;
+
+    FILE* file;
+    vector<char> fileBuffer;
+    vector<uint8_t> chunk;
+    uint32_t count = 0;
+    uint64_t first_seq = 0;
+    int64_t first_cycle = 0, max_cycle = 0, prev_cycle = 0;
+    uint32_t prev_pc = 0;
+    bool slots;
+
+    void flushChunk() {
+        if (count == 0) return;
+        vector<uint8_t> header;
+        putLE<uint32_t>(header, uint32_t(chunk.size()));
+        putLE<uint32_t>(header, count);
+        putLE<uint64_t>(header, first_seq);
+        putLE<uint64_t>(header, uint64_t(first_cycle));
+        putLE<uint64_t>(header, uint64_t(max_cycle));
+        fwrite(header.data(), 1, header.size(), file);
+        fwrite(chunk.data(), 1, chunk.size(), file);
+        chunk.clear();
+        count = 0;
+    }
+
+public:
+    // With slots, every record keeps the slot of each stage it entered
+    BinaryTraceWriter(FILE* file, const vector<string_view>& instructions, uint32_t base = 0, bool slots = false)
+        : file(file), fileBuffer(1 << 20), slots(slots) {
+        setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+        vector<uint8_t> header(traceMagic, traceMagic + 8);
+        putLE<uint16_t>(header, traceVersion);
+        putLE<uint16_t>(header, slots ? TRACE_FILE_SLOTS : 0);
+        putLE<uint32_t>(header, uint32_t(instructions.size()));
+        for (size_t i = 0; i < instructions.size(); i++) {
+            putLE<uint32_t>(header, uint32_t(base + i * 4));
+            putVarint(header, instructions[i].size());
+            header.insert(header.end(), instructions[i].begin(), instructions[i].end());
+        }
+        fwrite(header.data(), 1, header.size(), file);
+        chunk.reserve(64 * 1024);
+    }
+
+    void write(const StageRecord& rec) override {
+        if (count == 0) {
+            first_seq = rec.seq;
+            first_cycle = prev_cycle = max_cycle = rec.enter[STAGE_IF];
+            prev_pc = 0;
+        }
+        putVarint(chunk, zigzag(int64_t(rec.pc) - int64_t(prev_pc)));
+        prev_pc = rec.pc;
+
+        uint8_t flags = rec.squashed ? TRACE_SQUASHED : 0;
+        int64_t last_entry = -1;
+        for (int s = 0; s < NUM_STAGES; s++) {
+            if (rec.enter[s] >= 0) {
+                flags |= uint8_t(1 << s);
+                last_entry = rec.enter[s];
+                if (rec.split[s]) flags |= TRACE_SPLIT;
+            }
+        }
+        if (rec.last > last_entry) flags |= TRACE_TAIL;
+        chunk.push_back(flags);
+
+        putVarint(chunk, uint64_t(rec.enter[STAGE_IF] - prev_cycle));
+        prev_cycle = rec.enter[STAGE_IF];
+        int64_t prev_entry = rec.enter[STAGE_IF];
+        for (int s = STAGE_ID; s < NUM_STAGES; s++) {
+            if (rec.enter[s] >= 0) {
+                putVarint(chunk, uint64_t(rec.enter[s] - prev_entry));
+                prev_entry = rec.enter[s];
+            }
+        }
+        if (flags & TRACE_TAIL) putVarint(chunk, uint64_t(rec.last - last_entry));
+        if (slots) {
+            for (int s = 0; s < NUM_STAGES; s++) {
+                if (rec.enter[s] >= 0) chunk.push_back(rec.slot[s]);
+            }
+        }
+        if (flags & TRACE_SPLIT) {
+            for (int s = 0; s < NUM_STAGES; s++) {
+                if (rec.enter[s] >= 0) putVarint(chunk, rec.split[s]);
+            }
+        }
+
+        max_cycle = max(max_cycle, rec.last);
+        if (++count == chunkRecords) flushChunk();
+    }
+
+    void finish() override {
+        flushChunk();
+        fflush(file);
+    }
+};
+
+// Streams records back out of a binary trace one chunk at a time
+class BinaryTraceReader {
+    FILE* file;
+    vector<uint8_t> payload;
+    const uint8_t* p = nullptr;
+    const uint8_t* end = nullptr;
+    uint32_t remaining = 0;
+    uint64_t next_seq = 0;
+    int64_t prev_cycle = 0;
+    uint32_t prev_pc = 0;
+    int64_t window_from = 0, window_to = INT64_MAX;
+
+    bool readExact(void* dst, size_t n) { return fread(dst, 1, n, file) == n; }
+
+    // Load the next chunk overlapping the cycle window, skipping the rest
+    bool nextChunk() {
+        uint8_t header[32];
+        while (readExact(header, sizeof(header))) {
+            uint32_t bytes = getLE<uint32_t>(header);
+            uint32_t records = getLE<uint32_t>(header + 4);
+            uint64_t first_seq = getLE<uint64_t>(header + 8);
+            int64_t first_cycle = int64_t(getLE<uint64_t>(header + 16));
+            int64_t max_cycle = int64_t(getLE<uint64_t>(header + 24));
+            if (max_cycle < window_from) {
+                fseek(file, bytes, SEEK_CUR);
+                continue;
+            }
+            if (first_cycle > window_to) return false; // IF cycles only grow from here on
+            payload.resize(bytes);
+            if (!readExact(payload.data(), bytes)) throw runtime_error("truncated trace chunk");
+            p = payload.data();
+            end = p + bytes;
+            remaining = records;
+            next_seq = first_seq;
+            prev_cycle = first_cycle;
+            prev_pc = 0;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    vector<string> instructions; // Instruction text indexed by (pc - base) / 4
+    uint32_t base = 0; // Lowest pc in the instruction table
+    uint16_t version = 0;
+    bool slots = false; // Records carry issue slots
+
+    explicit BinaryTraceReader(FILE* file) : file(file) {
+        uint8_t header[16];
+        if (!readExact(header, sizeof(header)) || memcmp(header, traceMagic, 8) != 0) {
+            throw runtime_error("not a pipeline trace file");
+        }
+        version = getLE<uint16_t>(header + 8);
+        if (version == 0 || version > traceVersion) {
+            throw runtime_error("unsupported trace version " + to_string(version));
+        }
+        uint16_t flags = getLE<uint16_t>(header + 10);
+        if (flags & ~TRACE_FILE_SLOTS) throw runtime_error("unsupported trace flags " + to_string(flags));
+        slots = flags & TRACE_FILE_SLOTS;
+        uint32_t n = getLE<uint32_t>(header + 12);
+        vector<pair<uint32_t, string>> table;
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t word[4];
+            if (!readExact(word, 4)) throw runtime_error("truncated instruction table");
+            uint32_t pc = getLE<uint32_t>(word);
+            uint64_t len = 0;
+            int shift = 0;
+            int c;
+            while ((c = fgetc(file)) != EOF) {
+                len |= uint64_t(c & 0x7F) << shift;
+                if (!(c & 0x80)) break;
+                shift += 7;
+            }
+            string text(len, '\0');
+            if (len && !readExact(&text[0], len)) throw runtime_error("truncated instruction table");
+            table.emplace_back(pc, move(text));
+        }
+        if (!table.empty()) base = min_element(table.begin(), table.end())->first;
+        for (auto& entry : table) {
+            size_t index = (entry.first - base) / 4;
+            if (instructions.size() <= index) instructions.resize(index + 1);
+            instructions[index] = move(entry.second);
+        }
+    }
+
+    // Text of the instruction at pc, or nullptr outside the table
+    const string* textAt(uint32_t pc) const {
+        size_t index = (pc - base) / 4;
+        return (pc >= base && index < instructions.size()) ? &instructions[index] : nullptr;
+    }
+
+    // Only chunks that may touch [from, to] are decoded
+    void setWindow(int64_t from, int64_t to) {
+        window_from = from;
+        window_to = to;
+    }
+
+    bool next(StageRecord& rec) {
+        while (remaining == 0) {
+            if (!nextChunk()) return false;
+        }
+        remaining--;
+        rec = StageRecord();
+        rec.seq = next_seq++;
+        prev_pc = uint32_t(int64_t(prev_pc) + unzigzag(getVarint(p, end)));
+        rec.pc = prev_pc;
+        if (p >= end) throw runtime_error("truncated trace record");
+        uint8_t flags = *p++;
+        rec.squashed = flags & TRACE_SQUASHED;
+        prev_cycle += int64_t(getVarint(p, end));
+        rec.enter[STAGE_IF] = prev_cycle;
+        int64_t entry = prev_cycle;
+        for (int s = STAGE_ID; s < NUM_STAGES; s++) {
+            if (flags & (1 << s)) {
+                entry += int64_t(getVarint(p, end));
+                rec.enter[s] = entry;
+            }
+        }
+        rec.last = entry;
+        if (flags & TRACE_TAIL) rec.last += int64_t(getVarint(p, end));
+        if (slots) {
+            for (int s = 0; s < NUM_STAGES; s++) {
+                if (rec.enter[s] < 0) continue;
+                if (p >= end) throw runtime_error("truncated trace record");
+                rec.slot[s] = *p++;
+            }
+        }
+        if (flags & TRACE_SPLIT) {
+            for (int s = 0; s < NUM_STAGES; s++) {
+                if (rec.enter[s] >= 0) rec.split[s] = uint16_t(getVarint(p, end));
+            }
+        }
+        return true;
+    }
+};
+
+// Stall cycles the record spent inside [from, to], split by the stage it was held in.
+// The cycle a split stage moves to its second half is work, not a stall.
+inline int64_t stallCycles(const StageRecord& rec, int64_t from, int64_t to, int64_t perStage[NUM_STAGES]) {
+    int64_t total = 0;
+    for (int s = 0; s < NUM_STAGES; s++) {
+        if (rec.enter[s] < 0) continue;
+        // Until the next stage it entered, skipping any it never did
+        int64_t leave = rec.last;
+        for (int later = s + 1; later < NUM_STAGES; later++) {
+            if (rec.enter[later] >= 0) {
+                leave = rec.enter[later] - 1;
+                break;
+            }
+        }
+        int64_t lo = max(rec.enter[s] + 1, from), hi = min(leave, to);
+        if (hi < lo) continue;
+        int64_t second = rec.enter[s] + rec.split[s];
+        int64_t held = hi - lo + 1 - (rec.split[s] && second >= lo && second <= hi ? 1 : 0);
+        perStage[s] += held;
+        total += held;
+    }
+    return total;
+}
@@ -0,0 +1,126 @@
+#include <bits/stdc++.h>
+#include "trace.hpp"
+#include "tracefile.hpp"
+
+using namespace std;
+
+// Offline companion for binary pipeline traces written with --format binary.
+//   info   : header and record totals
+//   text   : convert (a cycle range of) the trace back to the semicolon diagram
+//   stalls : stall cycles per pc inside a cycle range, optionally for one pc
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " info <trace>\n"
+         << "       " << prog << " text <trace> [--from C] [--to C] [--out <file>]\n"
+         << "       " << prog << " stalls <trace> [--pc 0x1c] [--from C] [--to C]\n"
+         << "Cycles are numbered from 1 as in the simulator's trace output." << endl;
+}
+
+static string instructionText(const BinaryTraceReader& reader, uint32_t pc) {
+    if (const string* text = reader.textAt(pc)) return *text;
+    stringstream ss;
+    ss << "<pc 0x" << hex << pc << ">";
+    return ss.str();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    string command = argv[1];
+    string tracePath = argv[2];
+    int64_t from = 0, to = INT64_MAX;
+    bool havePc = false;
+    uint32_t pcFilter = 0;
+    string outPath;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--from") from = stoll(value) - 1;
+        else if (arg == "--to") to = stoll(value) - 1;
+        else if (arg == "--pc") { pcFilter = uint32_t(stoul(value, nullptr, 0)); havePc = true; }
+        else if (arg == "--out" || arg == "-o") outPath = value;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(tracePath.c_str(), "rb");
+    if (!file) {
+        cerr << "Error opening " << tracePath << endl;
+        return 1;
+    }
+
+    try {
+        BinaryTraceReader reader(file);
+        reader.setWindow(from, to);
+        StageRecord rec;
+
+        if (command == "info") {
+            uint64_t records = 0, squashed = 0;
+            int64_t lastCycle = -1;
+            while (reader.next(rec)) {
+                records++;
+                squashed += rec.squashed;
+                lastCycle = max(lastCycle, rec.last);
+            }
+            cout << "Trace version: " << reader.version << "\n";
+            cout << "Issue slots: " << (reader.slots ? "yes" : "no") << "\n";
+            cout << "Static instructions: " << reader.instructions.size() << "\n";
+            cout << "Dynamic instructions: " << records << " (" << squashed << " squashed)\n";
+            cout << "Cycles: " << lastCycle + 1 << "\n";
+        } else if (command == "text") {
+            ofstream outFile;
+            if (!outPath.empty()) {
+                outFile.open(outPath);
+                if (!outFile.is_open()) {
+                    cerr << "Error opening " << outPath << endl;
+                    return 1;
+                }
+            }
+            ostream& out = outPath.empty() ? cout : outFile;
+            while (reader.next(rec)) {
+                if (rec.last < from || rec.enter[STAGE_IF] > to) continue;
+                writeDiagramRow(out, instructionText(reader, rec.pc), rec, from, to, reader.slots);
+            }
+        } else if (command == "stalls") {
+            struct PcStalls { uint64_t instances = 0; int64_t total = 0; int64_t perStage[NUM_STAGES] = {}; };
+            map<uint32_t, PcStalls> byPc;
+            while (reader.next(rec)) {
+                if (havePc && rec.pc != pcFilter) continue;
+                if (rec.last < from || rec.enter[STAGE_IF] > to) continue;
+                PcStalls& entry = byPc[rec.pc];
+                entry.instances++;
+                entry.total += stallCycles(rec, from, to, entry.perStage);
+            }
+            vector<pair<uint32_t, PcStalls>> rows(byPc.begin(), byPc.end());
+            stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.total > b.second.total; });
+            cout << "pc;instruction;instances;stall_cycles";
+            for (int s = 0; s < NUM_STAGES; s++) cout << ";" << stageNames[s];
+            cout << "\n";
+            for (auto& row : rows) {
+                if (!havePc && row.second.total == 0) continue;
+                cout << "0x" << hex << row.first << dec << ";" << instructionText(reader, row.first) << ";"
+                     << row.second.instances << ";" << row.second.total;
+                for (int s = 0; s < NUM_STAGES; s++) cout << ";" << row.second.perStage[s];
+                cout << "\n";
+            }
+        } else {
+            usage(argv[0]);
+            fclose(file);
+            return 1;
+        }
+    } catch (const exception& e) {
+        cerr << "Error reading " << tracePath << ": " << e.what() << endl;
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+    return 0;
+}